@@ -0,0 +1,277 @@
+//
+// AntRandom.cpp
+//
+// Copyright (c) 2006-2007 Pascal Drecker
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+
+
+///// includes /////
+
+#include "AntRandom.h"
+#include <string.h>
+
+#if defined(MACS_RANDOM_XOSHIRO) && defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+///// defines /////
+
+// 52 random bits as mantissa of a double in [1,2)
+#define RANDOM_DOUBLE_ONE	0x3FF0000000000000ULL
+
+
+///// functions /////
+
+static unsigned long long splitmix64(unsigned long long *pullState)
+{
+	unsigned long long z;
+
+	z = (*pullState += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+	return z ^ (z >> 31);
+}
+
+static inline unsigned long long rotl64(unsigned long long x, int k)
+{
+	return (x << k) | (x >> (64-k));
+}
+
+
+///// classes /////
+
+AntRandom::AntRandom()
+{
+	m_iNext = ANT_RANDOM_BUFFER_SIZE;
+
+#ifndef MACS_RANDOM_MT
+	seed(0);
+#endif
+}
+
+AntRandom::~AntRandom()
+{
+}
+
+// every lane gets its own state from splitmix64
+void AntRandom::seed(unsigned int uSeed)
+{
+#if defined(MACS_RANDOM_MT)
+	m_MTRand.seed((MTRand::uint32)uSeed);
+#else
+	int i;
+	unsigned long long ullSplitMix;
+
+	ullSplitMix = uSeed;
+
+	for (i=0; i<ANT_RANDOM_LANES; i++)
+	{
+#if defined(MACS_RANDOM_PCG)
+		m_pullInc[i] = splitmix64(&ullSplitMix) | 1;
+		m_pullState[i] = splitmix64(&ullSplitMix) + m_pullInc[i];
+#else
+		// all zero is the only forbidden state, splitmix64 doesn't
+		// return zero four times in a row
+		m_ppullState[0][i] = splitmix64(&ullSplitMix);
+		m_ppullState[1][i] = splitmix64(&ullSplitMix);
+		m_ppullState[2][i] = splitmix64(&ullSplitMix);
+		m_ppullState[3][i] = splitmix64(&ullSplitMix);
+#endif
+	}
+#endif
+
+	m_iNext = ANT_RANDOM_BUFFER_SIZE;
+}
+
+// seed from /dev/urandom or the clock
+void AntRandom::seed()
+{
+#if defined(MACS_RANDOM_MT)
+	m_MTRand.seed();
+#else
+	MTRand Seeder;
+
+	seed((unsigned int)Seeder.randInt());
+#endif
+}
+
+// integer in [0,n], unused bits are tossed like in MTRand
+unsigned int AntRandom::randInt(unsigned int n)
+{
+#if defined(MACS_RANDOM_MT)
+	return (unsigned int)m_MTRand.randInt((MTRand::uint32)n);
+#else
+	unsigned int i, uUsed;
+
+	uUsed = n;
+	uUsed |= uUsed >> 1;
+	uUsed |= uUsed >> 2;
+	uUsed |= uUsed >> 4;
+	uUsed |= uUsed >> 8;
+	uUsed |= uUsed >> 16;
+
+	do
+		i = next() & uUsed;
+	while (i > n);
+
+	return i;
+#endif
+}
+
+// next 32 bits of the first lane
+unsigned int AntRandom::next()
+{
+#if defined(MACS_RANDOM_MT)
+	return (unsigned int)m_MTRand.randInt();
+#elif defined(MACS_RANDOM_PCG)
+	unsigned int uXorShifted, uRot;
+	unsigned long long ullOld;
+
+	// pcg32, xsh rr
+	ullOld = m_pullState[0];
+	m_pullState[0] = ullOld * 6364136223846793005ULL + m_pullInc[0];
+
+	uXorShifted = (unsigned int)(((ullOld >> 18) ^ ullOld) >> 27);
+	uRot = (unsigned int)(ullOld >> 59);
+
+	return (uXorShifted >> uRot) | (uXorShifted << ((32-uRot) & 31));
+#else
+	unsigned long long ullResult, ullT;
+	unsigned long long *s0, *s1, *s2, *s3;
+
+	s0 = &m_ppullState[0][0];
+	s1 = &m_ppullState[1][0];
+	s2 = &m_ppullState[2][0];
+	s3 = &m_ppullState[3][0];
+
+	// xoshiro256**
+	ullResult = rotl64(*s1 * 5, 7) * 9;
+	ullT = *s1 << 17;
+
+	*s2 ^= *s0;
+	*s3 ^= *s1;
+	*s1 ^= *s2;
+	*s0 ^= *s3;
+	*s2 ^= ullT;
+	*s3 = rotl64(*s3, 45);
+
+	return (unsigned int)(ullResult >> 32);
+#endif
+}
+
+// ANT_RANDOM_BUFFER_SIZE new doubles, the lanes are stepped together so
+// the buffer is the same with and without AVX2
+void AntRandom::refill()
+{
+#if defined(MACS_RANDOM_MT)
+	// unbuffered
+#elif defined(MACS_RANDOM_PCG)
+	int i, j;
+	unsigned int uXorShifted, uRot, uOut;
+	unsigned long long ullOld;
+
+	// independent lanes, the multiplications overlap
+	for (i=0; i<ANT_RANDOM_BUFFER_SIZE; i+=ANT_RANDOM_LANES)
+	{
+		for (j=0; j<ANT_RANDOM_LANES; j++)
+		{
+			ullOld = m_pullState[j];
+			m_pullState[j] = ullOld * 6364136223846793005ULL + m_pullInc[j];
+
+			uXorShifted = (unsigned int)(((ullOld >> 18) ^ ullOld) >> 27);
+			uRot = (unsigned int)(ullOld >> 59);
+			uOut = (uXorShifted >> uRot) | (uXorShifted << ((32-uRot) & 31));
+
+			m_pdBuffer[i+j] = uOut * (1.0/4294967296.0);
+		}
+	}
+#elif defined(MACS_RANDOM_XOSHIRO) && defined(__AVX2__)
+	int i;
+	__m256i s0, s1, s2, s3, vResult, vT;
+	const __m256i vOne = _mm256_set1_epi64x((long long)RANDOM_DOUBLE_ONE);
+	const __m256d vdOne = _mm256_set1_pd(1.0);
+
+	s0 = _mm256_loadu_si256((const __m256i*)m_ppullState[0]);
+	s1 = _mm256_loadu_si256((const __m256i*)m_ppullState[1]);
+	s2 = _mm256_loadu_si256((const __m256i*)m_ppullState[2]);
+	s3 = _mm256_loadu_si256((const __m256i*)m_ppullState[3]);
+
+	for (i=0; i<ANT_RANDOM_BUFFER_SIZE; i+=ANT_RANDOM_LANES)
+	{
+		// rotl(s1*5, 7)*9 with shifts and adds
+		vResult = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1);
+		vResult = _mm256_or_si256(_mm256_slli_epi64(vResult, 7),
+								  _mm256_srli_epi64(vResult, 57));
+		vResult = _mm256_add_epi64(_mm256_slli_epi64(vResult, 3), vResult);
+
+		vT = _mm256_slli_epi64(s1, 17);
+
+		s2 = _mm256_xor_si256(s2, s0);
+		s3 = _mm256_xor_si256(s3, s1);
+		s1 = _mm256_xor_si256(s1, s2);
+		s0 = _mm256_xor_si256(s0, s3);
+		s2 = _mm256_xor_si256(s2, vT);
+		s3 = _mm256_or_si256(_mm256_slli_epi64(s3, 45),
+							 _mm256_srli_epi64(s3, 19));
+
+		vResult = _mm256_or_si256(_mm256_srli_epi64(vResult, 12), vOne);
+
+		_mm256_storeu_pd(&m_pdBuffer[i],
+			_mm256_sub_pd(_mm256_castsi256_pd(vResult), vdOne));
+	}
+
+	_mm256_storeu_si256((__m256i*)m_ppullState[0], s0);
+	_mm256_storeu_si256((__m256i*)m_ppullState[1], s1);
+	_mm256_storeu_si256((__m256i*)m_ppullState[2], s2);
+	_mm256_storeu_si256((__m256i*)m_ppullState[3], s3);
+#elif defined(MACS_RANDOM_XOSHIRO)
+	int i, j;
+	unsigned long long ullResult, ullT;
+	double dValue;
+
+	for (i=0; i<ANT_RANDOM_BUFFER_SIZE; i+=ANT_RANDOM_LANES)
+	{
+		for (j=0; j<ANT_RANDOM_LANES; j++)
+		{
+			ullResult = rotl64(m_ppullState[1][j] * 5, 7) * 9;
+			ullT = m_ppullState[1][j] << 17;
+
+			m_ppullState[2][j] ^= m_ppullState[0][j];
+			m_ppullState[3][j] ^= m_ppullState[1][j];
+			m_ppullState[1][j] ^= m_ppullState[2][j];
+			m_ppullState[0][j] ^= m_ppullState[3][j];
+			m_ppullState[2][j] ^= ullT;
+			m_ppullState[3][j] = rotl64(m_ppullState[3][j], 45);
+
+			ullResult = (ullResult >> 12) | RANDOM_DOUBLE_ONE;
+			memcpy(&dValue, &ullResult, sizeof(double));
+
+			m_pdBuffer[i+j] = dValue - 1.0;
+		}
+	}
+#endif
+
+	m_iNext = 0;
+}
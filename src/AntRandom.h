@@ -0,0 +1,109 @@
+//
+// AntRandom.h
+//
+// Copyright (c) 2006-2007 Pascal Drecker
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+
+#ifndef _ANTRANDOM_H_
+#define _ANTRANDOM_H_
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+
+///// includes /////
+
+#include "MersenneTwister.h"
+
+
+///// defines /////
+
+// generator of the ants, chosen at compile time: MACS_RANDOM_XOSHIRO
+// (default), MACS_RANDOM_PCG or MACS_RANDOM_MT, the mersenne twister of
+// the old runs
+#if !defined(MACS_RANDOM_MT) && !defined(MACS_RANDOM_PCG)
+#define MACS_RANDOM_XOSHIRO
+#endif
+
+#define ANT_RANDOM_LANES		4
+#define ANT_RANDOM_BUFFER_SIZE	64		// multiple of the lanes
+
+
+///// classes /////
+
+// random numbers of one ant. rand() takes the uniform doubles from a
+// buffer which is refilled in one go, the lanes of xoshiro256** are
+// stepped with AVX2 if available. with the mersenne twister every call
+// goes to MTRand, so the old runs keep their random numbers.
+class AntRandom
+{
+public:
+	AntRandom();
+
+	virtual ~AntRandom();
+
+	void seed(unsigned int uSeed);
+
+	void seed();
+
+	// real number in [0,1), [0,1] with the mersenne twister
+	double rand()
+#ifdef MACS_RANDOM_MT
+		{ return m_MTRand.rand(); };
+#else
+		{ if (m_iNext == ANT_RANDOM_BUFFER_SIZE) refill();
+		  return m_pdBuffer[m_iNext++]; };
+#endif
+
+	// integer in [0,2^32-1]
+	unsigned int randInt()
+#ifdef MACS_RANDOM_MT
+		{ return (unsigned int)m_MTRand.randInt(); };
+#else
+		{ return next(); };
+#endif
+
+	unsigned int randInt(unsigned int n);
+
+protected:
+	unsigned int next();
+
+	void refill();
+
+#if defined(MACS_RANDOM_MT)
+	MTRand m_MTRand;
+#elif defined(MACS_RANDOM_PCG)
+	unsigned long long m_pullState[ANT_RANDOM_LANES];
+	unsigned long long m_pullInc[ANT_RANDOM_LANES];
+#else
+	unsigned long long m_ppullState[4][ANT_RANDOM_LANES];	// word, lane
+#endif
+
+#ifndef MACS_RANDOM_MT
+	double m_pdBuffer[ANT_RANDOM_BUFFER_SIZE];
+#endif
+	int m_iNext;
+};
+
+#endif // _ANTRANDOM_H_
@@ -0,0 +1,398 @@
+//
+// PheromoneTable.cpp
+//
+// Copyright (c) 2006-2007 Pascal Drecker
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+
+///// includes /////
+
+#include "PheromoneTable.h"
+#include "utils.h"
+#include <limits.h>
+
+
+///// defines /////
+
+#define PHEROMONE_ROW_MIN_CAPACITY	8
+
+
+///// classes /////
+
+PheromoneTable::PheromoneTable()
+{
+	m_iNodes = 0;
+	m_fDefault = 0.0f;
+	m_ppfMatrix = NULL;
+	m_pRows = NULL;
+	m_piRowEpoch = NULL;
+	m_iEpoch = 0;
+}
+
+PheromoneTable::~PheromoneTable()
+{
+	destroy();
+}
+
+int PheromoneTable::create(int iNodes, bool bSparse)
+{
+	int i;
+
+	// check params
+	if (iNodes < 1)
+		return -1;
+
+	destroy();
+
+	m_iNodes = iNodes;
+	m_iEpoch = 0;
+
+	m_piRowEpoch = (int*)malloc(sizeof(int)*iNodes);
+
+	if (m_piRowEpoch == NULL)
+	{
+		destroy();
+		return -2;
+	}
+
+	for (i=0; i<iNodes; i++)
+		m_piRowEpoch[i] = 0;
+
+	if (bSparse == false)
+	{
+		m_ppfMatrix = generate_float_matrix(iNodes, iNodes);
+
+		if (m_ppfMatrix == NULL)
+		{
+			destroy();
+			return -2;
+		}
+
+		return 0;
+	}
+
+	// sparse, the rows are allocated on their first update
+	m_pRows = (ROW_t*)malloc(sizeof(ROW_t)*iNodes);
+
+	if (m_pRows == NULL)
+	{
+		destroy();
+		return -2;
+	}
+
+	for (i=0; i<iNodes; i++)
+	{
+		m_pRows[i].piCols = NULL;
+		m_pRows[i].pfValues = NULL;
+		m_pRows[i].iCount = 0;
+		m_pRows[i].iMask = -1;
+	}
+
+	return 0;
+}
+
+void PheromoneTable::destroy()
+{
+	int i;
+
+	if (m_ppfMatrix != NULL)
+	{
+		free(m_ppfMatrix);
+		m_ppfMatrix = NULL;
+	}
+
+	if (m_pRows != NULL)
+	{
+		for (i=0; i<m_iNodes; i++)
+		{
+			if (m_pRows[i].piCols != NULL)
+				free(m_pRows[i].piCols);
+		}
+
+		free(m_pRows);
+		m_pRows = NULL;
+	}
+
+	if (m_piRowEpoch != NULL)
+	{
+		free(m_piRowEpoch);
+		m_piRowEpoch = NULL;
+	}
+
+	m_iNodes = 0;
+	m_iEpoch = 0;
+}
+
+// every arc gets dTau, O(1) apart from an epoch wrap around
+void PheromoneTable::reset(double dTau)
+{
+	int i;
+
+	m_fDefault = (float)dTau;
+
+	if (m_iEpoch == INT_MAX)
+	{
+		for (i=0; i<m_iNodes; i++)
+			m_piRowEpoch[i] = 0;
+
+		m_iEpoch = 0;
+	}
+
+	m_iEpoch++;
+}
+
+// carries the arcs over to the new reset value dTau. every arc keeps its
+// ratio to the reset value, smoothed toward 1 by dWeight, so the arcs that
+// still have the old reset value get dTau. O(arcs written in the epoch).
+void PheromoneTable::rescale(double dTau, double dWeight)
+{
+	int i, j;
+	double dFactor, dAdd;
+	float *pfRow;
+	ROW_t *pRow;
+
+	if (dWeight >= 1.0 || m_iEpoch == 0 || m_fDefault <= 0.0f)
+	{
+		reset(dTau);
+		return;
+	}
+
+	dFactor = (1.0-dWeight) * dTau / m_fDefault;
+	dAdd = dWeight * dTau;
+
+	for (i=0; i<m_iNodes; i++)
+	{
+		if (m_piRowEpoch[i] != m_iEpoch)
+			continue;
+
+		if (m_ppfMatrix != NULL)
+		{
+			pfRow = m_ppfMatrix[i];
+
+			for (j=0; j<m_iNodes; j++)
+				pfRow[j] = (float)(pfRow[j]*dFactor + dAdd);
+		}
+		else
+		{
+			pRow = &m_pRows[i];
+
+			for (j=0; j<=pRow->iMask; j++)
+			{
+				if (pRow->piCols[j] != -1)
+					pRow->pfValues[j] = (float)(pRow->pfValues[j]*dFactor + dAdd);
+			}
+		}
+	}
+
+	m_fDefault = (float)dTau;
+}
+
+// tau = tau * factor + add
+void PheromoneTable::update(int iRow, int iCol, double dFactor, double dAdd)
+{
+	int i;
+	ROW_t *pRow;
+
+	if (m_piRowEpoch[iRow] != m_iEpoch)
+		refreshRow(iRow);
+
+	if (m_ppfMatrix != NULL)
+	{
+		m_ppfMatrix[iRow][iCol] = (float)(m_ppfMatrix[iRow][iCol]*dFactor + dAdd);
+		return;
+	}
+
+	pRow = &m_pRows[iRow];
+
+	// keep the load at most 1/2. out of memory the row is used up to one
+	// free slot, which ends the probing of a missing arc
+	if (2*(pRow->iCount+1) > pRow->iMask+1)
+		growRow(pRow);
+
+	if (pRow->piCols == NULL)
+		return; // no memory for the row at all
+
+	for (i=hashCol(iCol, pRow->iMask); ; i=(i+1) & pRow->iMask)
+	{
+		if (pRow->piCols[i] == iCol)
+			break;
+
+		if (pRow->piCols[i] == -1)
+		{
+			if (pRow->iCount+1 >= pRow->iMask+1)
+				return; // row full, the arc keeps the reset value
+
+			pRow->piCols[i] = iCol;
+			pRow->pfValues[i] = m_fDefault;
+			pRow->iCount++;
+			break;
+		}
+	}
+
+	pRow->pfValues[i] = (float)(pRow->pfValues[i]*dFactor + dAdd);
+}
+
+// the dense row, or the row expanded into pfBuffer (m floats) if it is
+// sparse or wasn't written in the current epoch
+const float *PheromoneTable::getRow(int iRow, float *pfBuffer)
+{
+	int i;
+	ROW_t *pRow;
+
+	if (m_ppfMatrix != NULL && m_piRowEpoch[iRow] == m_iEpoch)
+		return m_ppfMatrix[iRow];
+
+	for (i=0; i<m_iNodes; i++)
+		pfBuffer[i] = m_fDefault;
+
+	if (m_ppfMatrix != NULL || m_piRowEpoch[iRow] != m_iEpoch)
+		return pfBuffer;
+
+	pRow = &m_pRows[iRow];
+
+	if (pRow->iCount != 0)
+	{
+		for (i=0; i<=pRow->iMask; i++)
+		{
+			if (pRow->piCols[i] != -1)
+				pfBuffer[pRow->piCols[i]] = pRow->pfValues[i];
+		}
+	}
+
+	return pfBuffer;
+}
+
+// arcs stored explicitly
+long long PheromoneTable::getArcCount()
+{
+	int i;
+	long long lCount;
+
+	if (m_ppfMatrix != NULL)
+		return (long long)m_iNodes * m_iNodes;
+
+	lCount = 0;
+
+	for (i=0; i<m_iNodes; i++)
+	{
+		if (m_piRowEpoch[i] == m_iEpoch)
+			lCount += m_pRows[i].iCount;
+	}
+
+	return lCount;
+}
+
+float PheromoneTable::getSparse(int iRow, int iCol)
+{
+	int i;
+	ROW_t *pRow;
+
+	pRow = &m_pRows[iRow];
+
+	if (pRow->iCount == 0)
+		return m_fDefault;
+
+	for (i=hashCol(iCol, pRow->iMask); ; i=(i+1) & pRow->iMask)
+	{
+		if (pRow->piCols[i] == iCol)
+			return pRow->pfValues[i];
+
+		if (pRow->piCols[i] == -1)
+			return m_fDefault;
+	}
+}
+
+// doubles the capacity of a row and rehashes its arcs
+int PheromoneTable::growRow(ROW_t *pRow)
+{
+	int i, j, iCapacity, iMask;
+	int *piCols;
+	float *pfValues;
+
+	iCapacity = 2*(pRow->iMask+1);
+
+	if (iCapacity < PHEROMONE_ROW_MIN_CAPACITY)
+		iCapacity = PHEROMONE_ROW_MIN_CAPACITY;
+
+	// columns and values in one block
+	piCols = (int*)malloc((sizeof(int)+sizeof(float))*iCapacity);
+
+	if (piCols == NULL)
+		return -1;
+
+	pfValues = (float*)(piCols + iCapacity);
+	iMask = iCapacity-1;
+
+	for (i=0; i<iCapacity; i++)
+		piCols[i] = -1;
+
+	for (i=0; i<=pRow->iMask; i++)
+	{
+		if (pRow->piCols[i] == -1)
+			continue;
+
+		for (j=hashCol(pRow->piCols[i], iMask); piCols[j]!=-1; j=(j+1) & iMask)
+			;
+
+		piCols[j] = pRow->piCols[i];
+		pfValues[j] = pRow->pfValues[i];
+	}
+
+	if (pRow->piCols != NULL)
+		free(pRow->piCols);
+
+	pRow->piCols = piCols;
+	pRow->pfValues = pfValues;
+	pRow->iMask = iMask;
+
+	return 0;
+}
+
+// first write of a row in the current epoch
+void PheromoneTable::refreshRow(int iRow)
+{
+	int i;
+	float *pfRow;
+	ROW_t *pRow;
+
+	if (m_ppfMatrix != NULL)
+	{
+		pfRow = m_ppfMatrix[iRow];
+
+		for (i=0; i<m_iNodes; i++)
+			pfRow[i] = m_fDefault;
+	}
+	else
+	{
+		pRow = &m_pRows[iRow];
+
+		if (pRow->iCount != 0)
+		{
+			for (i=0; i<=pRow->iMask; i++)
+				pRow->piCols[i] = -1;
+
+			pRow->iCount = 0;
+		}
+	}
+
+	m_piRowEpoch[iRow] = m_iEpoch;
+}
@@ -0,0 +1,107 @@
+//
+// PheromoneTable.h
+//
+// Copyright (c) 2006-2007 Pascal Drecker
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef _PHEROMONETABLE_H_
+#define _PHEROMONETABLE_H_
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+
+///// includes /////
+
+#include <stdlib.h>
+
+
+///// classes /////
+
+// pheromone of the arcs between m nodes. dense it is an m x m float matrix,
+// sparse every row is a small open addressing hash of the arcs that were
+// updated since the last reset, all other arcs have the reset value.
+// reset() only starts a new epoch, a row is reinitialized when it is
+// written the first time in the epoch and reads as the reset value before.
+// reading doesn't change the table, so several ants may read at once.
+// a sparse row that can't grow is filled beyond its load limit, if it is
+// full an update of a new arc is dropped and the arc keeps the reset value.
+class PheromoneTable
+{
+public:
+	PheromoneTable();
+
+	virtual ~PheromoneTable();
+
+	int create(int iNodes, bool bSparse);
+
+	void destroy();
+
+	void reset(double dTau);
+
+	void rescale(double dTau, double dWeight);
+
+	void update(int iRow, int iCol, double dFactor, double dAdd);
+
+	const float *getRow(int iRow, float *pfBuffer);
+
+	long long getArcCount();
+
+	float get(int iRow, int iCol)
+		{ if (m_piRowEpoch[iRow] != m_iEpoch) return m_fDefault;
+		  if (m_ppfMatrix != NULL) return m_ppfMatrix[iRow][iCol];
+		  return getSparse(iRow, iCol); };
+
+	bool isSparse() { return m_pRows != NULL; };
+
+	bool isInitialized() { return m_iEpoch != 0; };
+
+	int getNodeCount() { return m_iNodes; };
+
+protected:
+	typedef struct
+	{
+		int *piCols;		// -1 = empty slot
+		float *pfValues;
+		int iCount;
+		int iMask;			// capacity-1, capacity is a power of 2
+	} ROW_t;
+
+	float getSparse(int iRow, int iCol);
+
+	int growRow(ROW_t *pRow);
+
+	void refreshRow(int iRow);
+
+	static int hashCol(int iCol, int iMask)
+		{ return (int)(((unsigned int)iCol * 2654435761u) >> 7) & iMask; };
+
+	int m_iNodes;
+	float m_fDefault;
+	float **m_ppfMatrix;	// dense
+	ROW_t *m_pRows;			// sparse
+	int *m_piRowEpoch;		// epoch of the last write of a row
+	int m_iEpoch;
+};
+
+#endif // _PHEROMONETABLE_H_
@@ -0,0 +1,243 @@
+//
+// RouteCache.cpp
+//
+// Copyright (c) 2006-2007 Pascal Drecker
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+
+///// includes /////
+
+#include "RouteCache.h"
+#include "utils.h"
+#include <stdlib.h>
+
+
+///// classes /////
+
+RouteCache::RouteCache()
+{
+	m_iEntryCount = 0;
+	m_iMaxRouteLength = 0;
+	m_pEntries = NULL;
+	m_piRoutes = NULL;
+	m_iStripeCount = 0;
+	m_pStripes = NULL;
+}
+
+RouteCache::~RouteCache()
+{
+	destroy();
+}
+
+int RouteCache::create(int iEntryCount, int iMaxRouteLength)
+{
+	int i;
+
+	// check params
+	if (iEntryCount < 1 || iMaxRouteLength < 1)
+		return -1;
+
+	destroy();
+
+	// allocate memory
+	m_pEntries = (ENTRY_t*)malloc(sizeof(ENTRY_t)*iEntryCount);
+	m_piRoutes = (int*)malloc(sizeof(int)*2*(iMaxRouteLength+1)
+		* (long)iEntryCount);
+	m_pStripes = (STRIPE_t*)malloc(sizeof(STRIPE_t)*ROUTE_CACHE_STRIPES);
+
+	if (m_pEntries == NULL || m_piRoutes == NULL || m_pStripes == NULL)
+	{
+		destroy();
+		return -2;
+	}
+
+	m_iEntryCount = iEntryCount;
+	m_iMaxRouteLength = iMaxRouteLength;
+
+	for (i=0; i<ROUTE_CACHE_STRIPES; i++)
+	{
+		if (pthread_mutex_init(&m_pStripes[i].mutex, NULL) != 0)
+		{
+			destroy();
+			return -3;
+		}
+
+		m_pStripes[i].llLookups = 0;
+		m_pStripes[i].llHits = 0;
+		m_iStripeCount++;
+	}
+
+	clear();
+
+	return 0;
+}
+
+void RouteCache::destroy()
+{
+	int i;
+
+	for (i=0; i<m_iStripeCount; i++)
+		pthread_mutex_destroy(&m_pStripes[i].mutex);
+
+	m_iStripeCount = 0;
+
+	if (m_pStripes != NULL)
+	{
+		free(m_pStripes);
+		m_pStripes = NULL;
+	}
+
+	if (m_piRoutes != NULL)
+	{
+		free(m_piRoutes);
+		m_piRoutes = NULL;
+	}
+
+	if (m_pEntries != NULL)
+	{
+		free(m_pEntries);
+		m_pEntries = NULL;
+	}
+
+	m_iEntryCount = 0;
+	m_iMaxRouteLength = 0;
+}
+
+// removes all entries, the statistics are kept
+void RouteCache::clear()
+{
+	int i;
+
+	for (i=0; i<m_iEntryCount; i++)
+		m_pEntries[i].ullHash = 0;
+}
+
+// copies the stored result of the route to piResult
+bool RouteCache::lookup(const int *piRoute,
+						int iVariant,
+						int *piResult,
+						double *pdDistance,
+						bool *pbFeasible)
+{
+	bool bHit;
+	int iEntry;
+	unsigned long long ullHash;
+	STRIPE_t *pStripe;
+
+	if (m_iEntryCount == 0 || piRoute[0] > m_iMaxRouteLength)
+		return false;
+
+	ullHash = hashRoute(piRoute, iVariant);
+	iEntry = (int)(ullHash % m_iEntryCount);
+	pStripe = &m_pStripes[iEntry % m_iStripeCount];
+
+	pthread_mutex_lock(&pStripe->mutex);
+
+	bHit = m_pEntries[iEntry].ullHash == ullHash
+		&& m_pEntries[iEntry].iVariant == iVariant
+		&& IntCompare(getKey(iEntry), piRoute, piRoute[0]+1) == 0;
+
+	if (bHit)
+	{
+		IntCopy(piResult, getResult(iEntry), piRoute[0]+1);
+		*pdDistance = m_pEntries[iEntry].dDistance;
+		*pbFeasible = m_pEntries[iEntry].bFeasible;
+		pStripe->llHits++;
+	}
+
+	pStripe->llLookups++;
+
+	pthread_mutex_unlock(&pStripe->mutex);
+
+	return bHit;
+}
+
+// stores the result of the route, an older entry in the same slot is lost
+void RouteCache::insert(const int *piRoute,
+						int iVariant,
+						const int *piResult,
+						double dDistance,
+						bool bFeasible)
+{
+	int iEntry;
+	unsigned long long ullHash;
+	STRIPE_t *pStripe;
+
+	if (m_iEntryCount == 0 || piRoute[0] > m_iMaxRouteLength
+		|| piResult[0] != piRoute[0])
+	{
+		return;
+	}
+
+	ullHash = hashRoute(piRoute, iVariant);
+	iEntry = (int)(ullHash % m_iEntryCount);
+	pStripe = &m_pStripes[iEntry % m_iStripeCount];
+
+	pthread_mutex_lock(&pStripe->mutex);
+
+	IntCopy(getKey(iEntry), piRoute, piRoute[0]+1);
+	IntCopy(getResult(iEntry), piResult, piRoute[0]+1);
+	m_pEntries[iEntry].ullHash = ullHash;
+	m_pEntries[iEntry].iVariant = iVariant;
+	m_pEntries[iEntry].dDistance = dDistance;
+	m_pEntries[iEntry].bFeasible = bFeasible;
+
+	pthread_mutex_unlock(&pStripe->mutex);
+}
+
+void RouteCache::getStatistics(long long *pllLookups,
+							   long long *pllHits)
+{
+	int i;
+
+	*pllLookups = 0;
+	*pllHits = 0;
+
+	for (i=0; i<m_iStripeCount; i++)
+	{
+		pthread_mutex_lock(&m_pStripes[i].mutex);
+		*pllLookups += m_pStripes[i].llLookups;
+		*pllHits += m_pStripes[i].llHits;
+		pthread_mutex_unlock(&m_pStripes[i].mutex);
+	}
+}
+
+// FNV-1a over the variant, the length and the customers of the route,
+// never 0
+unsigned long long RouteCache::hashRoute(const int *piRoute,
+										 int iVariant)
+{
+	int i;
+	unsigned long long ullHash;
+
+	ullHash = 14695981039346656037ULL;
+	ullHash ^= (unsigned int)iVariant;
+	ullHash *= 1099511628211ULL;
+
+	for (i=0; i<=piRoute[0]; i++)
+	{
+		ullHash ^= (unsigned int)piRoute[i];
+		ullHash *= 1099511628211ULL;
+	}
+
+	return ullHash != 0 ? ullHash : 1;
+}
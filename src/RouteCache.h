@@ -0,0 +1,118 @@
+//
+// RouteCache.h
+//
+// Copyright (c) 2006-2007 Pascal Drecker
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef _ROUTECACHE_H_
+#define _ROUTECACHE_H_
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+
+///// includes /////
+
+#include "pthread.h"
+
+
+///// defines /////
+
+#define ROUTE_CACHE_STRIPES 64
+
+
+///// classes /////
+
+// a direct mapped hash table from a route to its improved version; the
+// key is an order-sensitive fingerprint of the route and the variant of the
+// search which improved it, the entries are compared in full. the slots
+// are locked by striped mutexes, so lookup() and insert() may be called
+// by several threads at a time.
+class RouteCache
+{
+public:
+	RouteCache();
+
+	virtual ~RouteCache();
+
+	int create(int iEntryCount, int iMaxRouteLength);
+
+	void destroy();
+
+	void clear();
+
+	bool lookup(const int *piRoute,
+				int iVariant,
+				int *piResult,
+				double *pdDistance,
+				bool *pbFeasible);
+
+	void insert(const int *piRoute,
+				int iVariant,
+				const int *piResult,
+				double dDistance,
+				bool bFeasible);
+
+	void getStatistics(long long *pllLookups,
+					   long long *pllHits);
+
+	int getEntryCount() { return m_iEntryCount; };
+
+	int getMaxRouteLength() { return m_iMaxRouteLength; };
+
+	static unsigned long long hashRoute(const int *piRoute,
+										int iVariant);
+
+protected:
+	typedef struct
+	{
+		unsigned long long ullHash;	// 0 = empty
+		int iVariant;
+		double dDistance;
+		bool bFeasible;
+	}
+	ENTRY_t;
+
+	typedef struct
+	{
+		pthread_mutex_t mutex;
+		long long llLookups;
+		long long llHits;
+	}
+	STRIPE_t;
+
+	int m_iEntryCount;
+	int m_iMaxRouteLength;
+	ENTRY_t *m_pEntries;
+	int *m_piRoutes;	// key and result of every entry
+	int m_iStripeCount;
+	STRIPE_t *m_pStripes;
+
+	int *getKey(int iEntry)
+		{ return m_piRoutes + (long)iEntry * 2 * (m_iMaxRouteLength+1); };
+
+	int *getResult(int iEntry)
+		{ return getKey(iEntry) + (m_iMaxRouteLength+1); };
+};
+
+#endif // _ROUTECACHE_H_
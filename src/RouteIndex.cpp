@@ -0,0 +1,179 @@
+//
+// RouteIndex.cpp
+//
+// Copyright (c) 2006-2007 Pascal Drecker
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+
+///// includes /////
+
+#include "RouteIndex.h"
+#include <stdlib.h>
+
+
+///// classes /////
+
+RouteIndex::RouteIndex()
+{
+	m_iCustomerCount = 0;
+	m_iMaxRouteCount = 0;
+	m_iRouteCount = 0;
+	m_piSucc = NULL;
+	m_piPred = NULL;
+	m_piRoute = NULL;
+	m_piPosition = NULL;
+}
+
+RouteIndex::~RouteIndex()
+{
+	destroy();
+}
+
+int RouteIndex::create(int iCustomerCount, int iMaxRouteCount)
+{
+	int iNodes;
+
+	// check params
+	if (iCustomerCount < 1 || iMaxRouteCount < 1)
+		return -1;
+
+	destroy();
+
+	// allocate memory, all arrays in one block
+	iNodes = iCustomerCount + iMaxRouteCount;
+
+	m_piSucc = (int*)malloc(sizeof(int)*iNodes*4);
+
+	if (m_piSucc == NULL)
+		return -2;
+
+	m_piPred = m_piSucc + iNodes;
+	m_piRoute = m_piPred + iNodes;
+	m_piPosition = m_piRoute + iNodes;
+
+	m_iCustomerCount = iCustomerCount;
+	m_iMaxRouteCount = iMaxRouteCount;
+	m_iRouteCount = 0;
+
+	return 0;
+}
+
+void RouteIndex::destroy()
+{
+	if (m_piSucc != NULL)
+	{
+		free(m_piSucc);
+		m_piSucc = NULL;
+		m_piPred = NULL;
+		m_piRoute = NULL;
+		m_piPosition = NULL;
+	}
+
+	m_iCustomerCount = 0;
+	m_iMaxRouteCount = 0;
+	m_iRouteCount = 0;
+}
+
+// indexes all routes of the tour matrix, fails if there are more routes
+// than the index was created for
+int RouteIndex::build(int iRouteCount, int **ppiTourMatrix)
+{
+	int iRoute;
+
+	if (iRouteCount > m_iMaxRouteCount)
+		return -1;
+
+	m_iRouteCount = iRouteCount;
+
+	for (iRoute=0; iRoute<iRouteCount; iRoute++)
+		updateRoute(iRoute, ppiTourMatrix[iRoute]);
+
+	return 0;
+}
+
+// takes the customers of route iRoute from the tour
+void RouteIndex::updateRoute(int iRoute, const int *piTour)
+{
+	int i, iLastNode, iNextNode;
+
+	iLastNode = getDepot(iRoute);
+	m_piRoute[iLastNode] = iRoute;
+	m_piPosition[iLastNode] = 0;
+
+	for (i=1; i<=piTour[0]; i++)
+	{
+		iNextNode = piTour[i];
+
+		m_piSucc[iLastNode] = iNextNode;
+		m_piPred[iNextNode] = iLastNode;
+		m_piRoute[iNextNode] = iRoute;
+		m_piPosition[iNextNode] = i;
+
+		iLastNode = iNextNode;
+	}
+
+	m_piSucc[iLastNode] = getDepot(iRoute);
+	m_piPred[getDepot(iRoute)] = iLastNode;
+}
+
+// writes the customers of route iRoute to the tour, updates the positions
+void RouteIndex::writeRoute(int iRoute, int *piTour)
+{
+	int i, iNode;
+
+	i = 0;
+
+	for (iNode = m_piSucc[getDepot(iRoute)]; isDepot(iNode) == false;
+		 iNode = m_piSucc[iNode])
+	{
+		piTour[++i] = iNode;
+		m_piPosition[iNode] = i;
+	}
+
+	piTour[0] = i;
+}
+
+// inserts the customer behind the customer or depot iNode
+void RouteIndex::insertAfter(int iNode, int iCustomer)
+{
+	int iNextNode;
+
+	iNextNode = m_piSucc[iNode];
+
+	m_piSucc[iCustomer] = iNextNode;
+	m_piPred[iCustomer] = iNode;
+	m_piSucc[iNode] = iCustomer;
+	m_piPred[iNextNode] = iCustomer;
+	m_piRoute[iCustomer] = m_piRoute[iNode];
+}
+
+void RouteIndex::remove(int iCustomer)
+{
+	int iLastNode, iNextNode;
+
+	iLastNode = m_piPred[iCustomer];
+	iNextNode = m_piSucc[iCustomer];
+
+	m_piSucc[iLastNode] = iNextNode;
+	m_piPred[iNextNode] = iLastNode;
+	m_piRoute[iCustomer] = -1;
+}
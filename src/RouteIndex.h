@@ -0,0 +1,86 @@
+//
+// RouteIndex.h
+//
+// Copyright (c) 2006-2007 Pascal Drecker
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef _ROUTEINDEX_H_
+#define _ROUTEINDEX_H_
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+
+///// classes /////
+
+// successor, predecessor, route and position of every customer of a tour
+// matrix. the nodes 0..n-1 are the customers, the node n+r is the depot of
+// route r, so every route is a cycle through its own depot. inserting and
+// removing a customer is O(1); the positions of a route are valid again
+// after updateRoute() or writeRoute().
+class RouteIndex
+{
+public:
+	RouteIndex();
+
+	virtual ~RouteIndex();
+
+	int create(int iCustomerCount, int iMaxRouteCount);
+
+	void destroy();
+
+	int build(int iRouteCount, int **ppiTourMatrix);
+
+	void updateRoute(int iRoute, const int *piTour);
+
+	void writeRoute(int iRoute, int *piTour);
+
+	void insertAfter(int iNode, int iCustomer);
+
+	void remove(int iCustomer);
+
+	int getSucc(int iNode) { return m_piSucc[iNode]; };
+
+	int getPred(int iNode) { return m_piPred[iNode]; };
+
+	int getRoute(int iNode) { return m_piRoute[iNode]; };
+
+	int getPosition(int iCustomer) { return m_piPosition[iCustomer]; };
+
+	int getDepot(int iRoute) { return m_iCustomerCount + iRoute; };
+
+	bool isDepot(int iNode) { return iNode >= m_iCustomerCount; };
+
+	int getRouteCount() { return m_iRouteCount; };
+
+protected:
+	int m_iCustomerCount;
+	int m_iMaxRouteCount;
+	int m_iRouteCount;
+	int *m_piSucc;
+	int *m_piPred;
+	int *m_piRoute;
+	int *m_piPosition;	// the depot is at position 0
+};
+
+#endif // _ROUTEINDEX_H_
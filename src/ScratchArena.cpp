@@ -0,0 +1,114 @@
+//
+// ScratchArena.cpp
+//
+// Copyright (c) 2006-2007 Pascal Drecker
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+
+///// includes /////
+
+#include "ScratchArena.h"
+
+
+///// classes /////
+
+ScratchArena::ScratchArena()
+{
+	m_pBuffer = NULL;
+	m_iSize = 0;
+	m_iUsed = 0;
+}
+
+ScratchArena::~ScratchArena()
+{
+	destroy();
+}
+
+int ScratchArena::create(int iSize)
+{
+	// check params
+	if (iSize < 0)
+		return -1;
+
+	// big enough already?
+	if (m_pBuffer != NULL && m_iSize >= iSize)
+	{
+		m_iUsed = 0;
+		return 0;
+	}
+
+	destroy();
+
+	// allocate memory
+	m_pBuffer = (char*)malloc(getAllocSize(iSize) + 15);
+
+	if (m_pBuffer == NULL)
+		return -2;
+
+	m_iSize = getAllocSize(iSize);
+	m_iUsed = 0;
+
+	return 0;
+}
+
+void ScratchArena::destroy()
+{
+	if (m_pBuffer != NULL)
+	{
+		free(m_pBuffer);
+		m_pBuffer = NULL;
+	}
+
+	m_iSize = 0;
+	m_iUsed = 0;
+}
+
+// 16 byte aligned buffer, NULL if the arena is exhausted
+void *ScratchArena::alloc(int iSize)
+{
+	char *pBuffer;
+
+	if (m_pBuffer == NULL || iSize < 0 || getAllocSize(iSize) > getFree())
+		return NULL;
+
+	pBuffer = (char*)(((size_t)m_pBuffer + 15) & ~(size_t)15) + m_iUsed;
+	m_iUsed += getAllocSize(iSize);
+
+	return (void*)pBuffer;
+}
+
+// m x n (rows x cols), same layout as generate_int_matrix()
+int **ScratchArena::allocIntMatrix(int iM, int iN)
+{
+	int i;
+	int **ppiMatrix;
+
+	ppiMatrix = (int**)alloc(sizeof(int) * iN * iM + sizeof(int *) * iM);
+
+	if (ppiMatrix == NULL)
+		return NULL;
+
+	for (i=0; i<iM; i++)
+		ppiMatrix[i] = (int*)(ppiMatrix + iM) + i * iN;
+
+	return ppiMatrix;
+}
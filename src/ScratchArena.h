@@ -0,0 +1,76 @@
+//
+// ScratchArena.h
+//
+// Copyright (c) 2006-2007 Pascal Drecker
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef _SCRATCHARENA_H_
+#define _SCRATCHARENA_H_
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+
+///// includes /////
+
+#include <stdlib.h>
+
+
+///// classes /////
+
+// a preallocated block of memory which hands out buffers by bumping an
+// offset; getMark() and release() free everything allocated in between.
+// an arena must only be used by one thread at a time.
+class ScratchArena
+{
+public:
+	ScratchArena();
+
+	virtual ~ScratchArena();
+
+	int create(int iSize);
+
+	void destroy();
+
+	void *alloc(int iSize);
+
+	int **allocIntMatrix(int iM, int iN);
+
+	int getMark() { return m_iUsed; };
+
+	void release(int iMark) { if (iMark >= 0 && iMark <= m_iUsed) m_iUsed = iMark; };
+
+	int getSize() { return m_iSize; };
+
+	int getFree() { return m_iSize - m_iUsed; };
+
+	// bytes needed for a buffer of iSize, including the alignment
+	static int getAllocSize(int iSize) { return (iSize + 15) & ~15; };
+
+protected:
+	char *m_pBuffer;
+	int m_iSize;
+	int m_iUsed;
+};
+
+#endif // _SCRATCHARENA_H_
@@ -0,0 +1,178 @@
+//
+// SolutionMailbox.cpp
+//
+// Copyright (c) 2006-2007 Pascal Drecker
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+
+///// includes /////
+
+#include "SolutionMailbox.h"
+#include "utils.h"
+
+
+///// defines /////
+
+#define MAILBOX_NEW		4
+
+
+///// classes /////
+
+SolutionMailbox::SolutionMailbox()
+{
+	int i;
+
+	m_iMaxVehicleCount = 0;
+	m_iToursMaxSize = 0;
+
+	for (i=0; i<3; i++)
+		m_Slots[i].ppiTourMatrix = NULL;
+
+	clear();
+}
+
+SolutionMailbox::~SolutionMailbox()
+{
+	destroy();
+}
+
+int SolutionMailbox::create(int iMaxVehicleCount, int iToursMaxSize)
+{
+	int i;
+
+	// check params
+	if (iMaxVehicleCount < 1 || iToursMaxSize < 1)
+		return -1;
+
+	destroy();
+
+	// the depot number is kept behind the customers
+	for (i=0; i<3; i++)
+	{
+		m_Slots[i].ppiTourMatrix = generate_int_matrix(iMaxVehicleCount,
+													   iToursMaxSize+1);
+
+		if (m_Slots[i].ppiTourMatrix == NULL)
+		{
+			destroy();
+			return -2;
+		}
+	}
+
+	m_iMaxVehicleCount = iMaxVehicleCount;
+	m_iToursMaxSize = iToursMaxSize;
+
+	clear();
+
+	return 0;
+}
+
+void SolutionMailbox::destroy()
+{
+	int i;
+
+	for (i=0; i<3; i++)
+	{
+		if (m_Slots[i].ppiTourMatrix != NULL)
+		{
+			free(m_Slots[i].ppiTourMatrix);
+			m_Slots[i].ppiTourMatrix = NULL;
+		}
+	}
+
+	m_iMaxVehicleCount = 0;
+	m_iToursMaxSize = 0;
+}
+
+// drop a solution not taken yet, neither sender nor receiver may be active
+void SolutionMailbox::clear()
+{
+	int i;
+
+	for (i=0; i<3; i++)
+	{
+		m_Slots[i].iVehicleCount = 0;
+		m_Slots[i].dDistance = 0.0;
+	}
+
+	m_iSend = 0;
+	m_iMiddle = 1;
+	m_iReceive = 2;
+}
+
+void SolutionMailbox::post(int iVehicleCount,
+						   double dDistance,
+						   int **ppiTourMatrix)
+{
+	SLOT_t *pSlot;
+
+	if (iVehicleCount < 1 || iVehicleCount > m_iMaxVehicleCount)
+		return;
+
+	pSlot = &m_Slots[m_iSend];
+
+	pSlot->iVehicleCount = iVehicleCount;
+	pSlot->dDistance = dDistance;
+	copySolution(iVehicleCount, pSlot->ppiTourMatrix, ppiTourMatrix);
+
+	// publish the solution, the sender gets the old middle slot
+	m_iSend = IntAtomicExchange(&m_iMiddle, m_iSend | MAILBOX_NEW)
+		& ~MAILBOX_NEW;
+}
+
+// copies the latest solution posted since the last call, false if there
+// is none
+bool SolutionMailbox::take(int *piVehicleCount,
+						   double *pdDistance,
+						   int **ppiTourMatrix)
+{
+	SLOT_t *pSlot;
+
+	if (m_iToursMaxSize == 0
+		|| (IntAtomicLoad(&m_iMiddle) & MAILBOX_NEW) == 0)
+	{
+		return false;
+	}
+
+	m_iReceive = IntAtomicExchange(&m_iMiddle, m_iReceive) & ~MAILBOX_NEW;
+
+	pSlot = &m_Slots[m_iReceive];
+
+	*piVehicleCount = pSlot->iVehicleCount;
+	*pdDistance = pSlot->dDistance;
+	copySolution(pSlot->iVehicleCount, ppiTourMatrix, pSlot->ppiTourMatrix);
+
+	return true;
+}
+
+void SolutionMailbox::copySolution(int iVehicleCount,
+								   int **ppiDest,
+								   int **ppiSrc)
+{
+	int i;
+
+	for (i=0; i<iVehicleCount; i++)
+	{
+		IntCopy(ppiDest[i], ppiSrc[i], ppiSrc[i][0]+1); // customers
+		ppiDest[i][m_iToursMaxSize] = ppiSrc[i][m_iToursMaxSize]; // depot number
+	}
+}
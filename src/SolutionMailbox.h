@@ -0,0 +1,82 @@
+//
+// SolutionMailbox.h
+//
+// Copyright (c) 2006-2007 Pascal Drecker
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef _SOLUTIONMAILBOX_H_
+#define _SOLUTIONMAILBOX_H_
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+
+///// includes /////
+
+#include <stdlib.h>
+
+
+///// classes /////
+
+// hands the latest solution of one thread to one other thread without
+// locks. the solutions are kept in three buffers: the sender writes its
+// own buffer and swaps it with the middle one, the receiver swaps its own
+// buffer with the middle one if that holds a new solution. an older
+// solution not taken yet is replaced.
+class SolutionMailbox
+{
+public:
+	SolutionMailbox();
+
+	virtual ~SolutionMailbox();
+
+	int create(int iMaxVehicleCount, int iToursMaxSize);
+
+	void destroy();
+
+	void clear();
+
+	void post(int iVehicleCount, double dDistance, int **ppiTourMatrix);
+
+	bool take(int *piVehicleCount, double *pdDistance, int **ppiTourMatrix);
+
+protected:
+	typedef struct
+	{
+		int iVehicleCount;
+		double dDistance;
+		int **ppiTourMatrix;
+	} SLOT_t;
+
+	void copySolution(int iVehicleCount, int **ppiDest, int **ppiSrc);
+
+	int m_iMaxVehicleCount;
+	int m_iToursMaxSize;
+	SLOT_t m_Slots[3];
+
+	int m_iSend;		// slot of the sender
+	int m_iMiddle;		// exchanged slot, MAILBOX_NEW if it holds a new solution
+	int m_iReceive;		// slot of the receiver
+};
+
+#endif // _SOLUTIONMAILBOX_H_
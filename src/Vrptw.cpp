@@ -31,9 +31,24 @@
 
 #include "Vrptw.h"
 #include "InstanceData.h"
+#include "WorkerPool.h"
+#include "ScratchArena.h"
+#include "RouteCache.h"
 #include "utils.h"
 #include <stdlib.h>
 #include <math.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+///// defines /////
+
+// improvements below are treated as rounding noise
+#define LS_MIN_IMPROVEMENT 1.0e-9
+
+// routes with more customers aren't cached
+#define ROUTE_CACHE_MAX_ROUTE_LENGTH 128
 
 
 ///// classes //////
@@ -41,20 +56,78 @@
 Vrptw::Vrptw()
 {
 	m_pInstanceData = NULL;
+	initLocalSearch();
 }
 
 Vrptw::Vrptw(InstanceData *pInstanceData)
 {
 	m_pInstanceData = pInstanceData;
+	initLocalSearch();
+}
+
+void Vrptw::initLocalSearch()
+{
+	int i;
+
+	m_iCrossMaxSegmentLength = 0;
+	m_dCrossMaxRouteDistance = 0.0;
+	m_iIntraMoveOrder = LS_INTRA_FIRST_IMPROVEMENT;
+	m_iIntraCandidates = 8;
+	m_iLocalSearchThreads = 1;
+	m_pLocalSearchPool = NULL;
+	m_pScratchArena = NULL;
+	m_iRouteCacheSize = 0;
+	m_pRouteCache = NULL;
+
+	// vnd: cheap operators first, no budgets
+	m_iVndOperatorCount = 5;
+	m_piVndOperators[0] = LS_RELOCATE;
+	m_piVndOperators[1] = LS_OR_OPT;
+	m_piVndOperators[2] = LS_TWO_OPT_STAR;
+	m_piVndOperators[3] = LS_INTRA_EXCHANGE;
+	m_piVndOperators[4] = LS_CROSS_EXCHANGE;
+	m_bVndAdaptive = false;
+	m_bReproducible = false;
+	pthread_mutex_init(&m_mutexVndStatistics, NULL);
+
+	for (i=0; i<LS_OPERATOR_COUNT; i++)
+	{
+		m_piVndBudget[i] = 0;
+		m_pdVndGain[i] = 0.0;
+		m_pllVndMicroseconds[i] = 0;
+	}
 }
 
 Vrptw::~Vrptw()
 {
+	if (m_pLocalSearchPool != NULL)
+	{
+		delete m_pLocalSearchPool;
+		m_pLocalSearchPool = NULL;
+	}
+
+	if (m_pScratchArena != NULL)
+	{
+		delete m_pScratchArena;
+		m_pScratchArena = NULL;
+	}
+
+	if (m_pRouteCache != NULL)
+	{
+		delete m_pRouteCache;
+		m_pRouteCache = NULL;
+	}
+
+	pthread_mutex_destroy(&m_mutexVndStatistics);
 }
 
 void Vrptw::applyInstanceData(InstanceData *pInstanceData)
 {
 	m_pInstanceData = pInstanceData;
+
+	// the cached routes belong to the old instance
+	if (m_pRouteCache != NULL)
+		m_pRouteCache->destroy();
 }
 
 // Nearest Neighbor heuristic by Solomon
@@ -672,7 +745,15 @@ int Vrptw::ls_cross_exchange(int iVehicleCount,
 		bSetSolution = false;
 
 	// allocate memory
-	ppiTourMatrix = generate_int_matrix(iVehicleCount, iCustomerCount+1);
+	if (prepareScratchArena(ScratchArena::getAllocSize(sizeof(int)
+			* iVehicleCount * (iCustomerCount+1) + sizeof(int *) * iVehicleCount)
+		+ getLocalSearchScratchSize(iVehicleCount)) != 0)
+	{
+		return -1;
+	}
+
+	ppiTourMatrix = m_pScratchArena->allocIntMatrix(iVehicleCount,
+													iCustomerCount+1);
 	
 	if (ppiTourMatrix == NULL)
 		return -1;
@@ -681,8 +762,12 @@ int Vrptw::ls_cross_exchange(int iVehicleCount,
 	convertToTourMatrix(iVehicleCount, piTours, ppiTourMatrix);
 
 	// do cross exchange
-	iRet = ls_cross_exchange_matrix(iVehicleCount, pdTotalDistance,
-		ppiTourMatrix, pbAbort);
+	if (m_iLocalSearchThreads > 1)
+		iRet = ls_cross_exchange_matrix_parallel(iVehicleCount, pdTotalDistance,
+			ppiTourMatrix, pbAbort);
+	else
+		iRet = ls_cross_exchange_matrix(iVehicleCount, pdTotalDistance,
+			ppiTourMatrix, pbAbort);
 
 	if (iRet == 0)
 	{
@@ -697,33 +782,29 @@ int Vrptw::ls_cross_exchange(int iVehicleCount,
 	}
 
 	// free memory
-	free(ppiTourMatrix);
+	m_pScratchArena->release(0);
 
 	return iRet;
 }
 
+// Without a state every route pair is examined once. With a state only the
+// pairs with a dirty route are examined, and the passes are repeated for the
+// routes changed in the last pass until no improving move is left.
+//
 int Vrptw::ls_cross_exchange_matrix(int iVehicleCount,
 									double *pdTotalDistance,
 									int **ppiTourMatrix,
-									bool *pbAbort)
+									bool *pbAbort,
+									LS_STATE_t *pState)
 {
-	bool bAbort;
-	int i, iCount, iDepotDueDate, iCapacity, iMaxCapacity;
-	int iX1, iX2, iY1, iY2, iBestX1, iBestX2, iBestY1, iBestY2;
-	int iLastCustomer, iNextCustomer, iCustomerCount;
-	int iRoute1, iRoute2, iCustomerCount1, iCustomerCount2;
-	int iCustomerX1_0, iCustomerX2_0, iCustomerY1_0, iCustomerY2_0;
-	int iCustomerX1_1, iCustomerX2_1, iCustomerY1_1, iCustomerY2_1;
-	double dTime, dDistDiff1, dDistDiff2, dBestDistDiff, dTotalDistance;
-	int *piCustomerDemand, *piCustomerReadyTime, *piCustomerDueDate;
-	int *piCustomerServiceTime, *piTempTour1, *piTempTour2;
-	double **ppdDistanceMatrix;
-
-	if (pbAbort == NULL)
-	{
-		bAbort = false;
-		pbAbort = &bAbort;
-	}
+	bool bChanged;
+	int iRoute1, iRoute2, iCustomerCount, iMark;
+	double dTotalDistance;
+	int *piTempTour1, *piTempTour2;
+	char *pSchedule;
+	CROSS_MOVE_t Move;
+	ROUTE_SUMMARY_t *pSummaries;
+	ScratchArena *pArena;
 
 	// check params
 	if (m_pInstanceData == NULL)
@@ -732,464 +813,3219 @@ int Vrptw::ls_cross_exchange_matrix(int iVehicleCount,
 	dTotalDistance = *pdTotalDistance;
 
 	iCustomerCount = m_pInstanceData->getCustomerCount();
-	iDepotDueDate = m_pInstanceData->getDepotDueDate();
-	iMaxCapacity = m_pInstanceData->getCapacity();
-	
-	if ((piTempTour1 = (int *)malloc(sizeof(int) * iCustomerCount+1)) == NULL)
-		return -1;
 
-	if ((piTempTour2 = (int *)malloc(sizeof(int) * iCustomerCount+1)) == NULL)
+	// allocate memory
+	pArena = getScratchArena(iVehicleCount, pState);
+	iMark = pArena->getMark();
+
+	piTempTour1 = (int *)pArena->alloc(sizeof(int) * (iCustomerCount+1));
+	piTempTour2 = (int *)pArena->alloc(sizeof(int) * (iCustomerCount+1));
+	pSchedule = (char *)pArena->alloc(getRoutePairScheduleSize());
+	pSummaries = (ROUTE_SUMMARY_t *)pArena->alloc(sizeof(ROUTE_SUMMARY_t)
+		* iVehicleCount);
+
+	if (piTempTour1 == NULL || piTempTour2 == NULL || pSchedule == NULL
+		|| pSummaries == NULL)
 	{
-		free(piTempTour1);
+		pArena->release(iMark);
 		return -1;
 	}
 
-	piCustomerDemand = m_pInstanceData->getCustomerDemand();
-	piCustomerReadyTime = m_pInstanceData->getCustomerReadyTime();
-	piCustomerDueDate = m_pInstanceData->getCustomerDueDate();
-	piCustomerServiceTime = m_pInstanceData->getCustomerServiceTime();
-	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+	for (iRoute1=0; iRoute1<iVehicleCount; iRoute1++)
+		calcRouteSummary(ppiTourMatrix[iRoute1], &pSummaries[iRoute1]);
 
-	for (iRoute1=0; iRoute1<iVehicleCount-1; iRoute1++)	// route 1
+	do
 	{
-		for (iRoute2=iRoute1+1; iRoute2<iVehicleCount; iRoute2++) // route 2
+		bChanged = false;
+
+		beginLocalSearchPass(iVehicleCount, pState);
+
+		for (iRoute1=0; iRoute1<iVehicleCount-1; iRoute1++)	// route 1
 		{
-			dBestDistDiff = 0.0;
+			for (iRoute2=iRoute1+1; iRoute2<iVehicleCount; iRoute2++) // route 2
+			{
+				// nothing changed since the last examination?
+				if (isRouteDirty(LS_CROSS_EXCHANGE, iRoute1, pState) == false
+					&& isRouteDirty(LS_CROSS_EXCHANGE, iRoute2, pState) == false)
+				{
+					continue;
+				}
 
-			iCustomerCount1 = ppiTourMatrix[iRoute1][0];
-			iCustomerCount2 = ppiTourMatrix[iRoute2][0];
+				if (isRoutePairPromising(&pSummaries[iRoute1],
+										 &pSummaries[iRoute2]) == false)
+				{
+					continue;
+				}
 
-			if (iCustomerCount1 < 2 || iCustomerCount2 < 2)
-				continue;
+				if (ls_cross_exchange_route_pair(ppiTourMatrix[iRoute1],
+												 ppiTourMatrix[iRoute2],
+												 pSchedule, pbAbort, &Move) != 0)
+				{
+					pArena->release(iMark);
+					return -1;
+				}
 
-			for (iX1 = 1; iX1 < iCustomerCount1; iX1++)
-			{
-				for (iX2 = 1; iX2 < iCustomerCount2; iX2++)
+				// better solution found?
+				if (Move.dDistDiff < 0.0)
 				{
-					if (*pbAbort)
-					{
-						free(piTempTour1);
-						free(piTempTour2);
-						return -1;
-					}
+					// build new tours
+					ls_cross_exchange_tour(Move.iX1, Move.iX2, Move.iY1, Move.iY2,
+						ppiTourMatrix[iRoute1][0], ppiTourMatrix[iRoute2][0],
+						ppiTourMatrix[iRoute1], ppiTourMatrix[iRoute2],
+						piTempTour1, piTempTour2);
 
-					iCustomerX1_0 = ppiTourMatrix[iRoute1][iX1];
-					iCustomerX1_1 = ppiTourMatrix[iRoute1][iX1+1];
-					iCustomerX2_0 = ppiTourMatrix[iRoute2][iX2];
-					iCustomerX2_1 = ppiTourMatrix[iRoute2][iX2+1];
+					IntCopy(ppiTourMatrix[iRoute1], piTempTour1, piTempTour1[0]+1);
+					IntCopy(ppiTourMatrix[iRoute2], piTempTour2, piTempTour2[0]+1);
 
-					// calc dist diff 1 = new1 + new2 - old1 - old2
-					dDistDiff1 = ppdDistanceMatrix[iCustomerX1_0][iCustomerX2_1];
-					dDistDiff1 += ppdDistanceMatrix[iCustomerX2_0][iCustomerX1_1];
-					dDistDiff1 -= ppdDistanceMatrix[iCustomerX1_0][iCustomerX1_1];
-					dDistDiff1 -= ppdDistanceMatrix[iCustomerX2_0][iCustomerX2_1];
+					dTotalDistance += Move.dDistDiff;
 
-					if (dDistDiff1 >= 0.0)
-						continue;
+					calcRouteSummary(ppiTourMatrix[iRoute1], &pSummaries[iRoute1]);
+					calcRouteSummary(ppiTourMatrix[iRoute2], &pSummaries[iRoute2]);
 
-					for (iY1 = iX1+1; iY1 <= iCustomerCount1; iY1++)
+					if (pState != NULL)
 					{
-						for (iY2 = iX2+1; iY2 <= iCustomerCount2; iY2++)
-						{
-							if (*pbAbort)
-							{
-								free(piTempTour1);
-								free(piTempTour2);
-								return -1;
-							}
-
-							iCustomerY1_0 = ppiTourMatrix[iRoute1][iY1];
-
-							if (iY1 < iCustomerCount1)
-								iCustomerY1_1 = ppiTourMatrix[iRoute1][iY1+1];
-							else
-								iCustomerY1_1 = iCustomerCount; // depot
-
-							iCustomerY2_0 = ppiTourMatrix[iRoute2][iY2];
-
-							if (iY2 < iCustomerCount2)
-								iCustomerY2_1 = ppiTourMatrix[iRoute2][iY2+1];
-							else
-								iCustomerY2_1 = iCustomerCount; // depot
-
-							// calc dist diff 2 = new1 + new2 - old1 - old2
-							dDistDiff2
-								= ppdDistanceMatrix[iCustomerY1_0][iCustomerY2_1];
-							dDistDiff2
-								+= ppdDistanceMatrix[iCustomerY2_0][iCustomerY1_1];
-							dDistDiff2
-								-= ppdDistanceMatrix[iCustomerY1_0][iCustomerY1_1];
-							dDistDiff2
-								-= ppdDistanceMatrix[iCustomerY2_0][iCustomerY2_1];
-
-							if (dDistDiff2 > 0.0)
-								continue;
-
-							// better solution found?
-							if (dBestDistDiff <= dDistDiff1+dDistDiff2)
-								continue;
-
-							// build new temp tours
-							ls_cross_exchange_tour(iX1, iX2, iY1, iY2,
-								iCustomerCount1, iCustomerCount2,
-								ppiTourMatrix[iRoute1],	ppiTourMatrix[iRoute2],
-								piTempTour1, piTempTour2);
-
-							// is new tour 1 feasible?
-							dTime = 0.0;
-							iCapacity = 0;
-							iLastCustomer = iCustomerCount; // depot
-							iCount = piTempTour1[0];
-
-							for (i=1; i<=iCount; i++)
-							{
-								iNextCustomer = piTempTour1[i];
-
-								// check capacity
-								iCapacity += piCustomerDemand[iNextCustomer];
-
-								if (iCapacity > iMaxCapacity)
-									break; // not feasible
-
-								// check time window
-								dTime +=
-								ppdDistanceMatrix[iLastCustomer][iNextCustomer];
-
-								if (dTime < piCustomerReadyTime[iNextCustomer])
-									dTime = piCustomerReadyTime[iNextCustomer];
-								else if (dTime > piCustomerDueDate[iNextCustomer])
-									break; // not feasible
-
-								dTime += piCustomerServiceTime[iNextCustomer];
-
-								iLastCustomer = iNextCustomer;
-							}
-
-							if (i <= iCount)
-								continue; // not feasible
-
-							if (ppdDistanceMatrix[iLastCustomer][iCustomerCount]
-								+ dTime	> iDepotDueDate)
-							{
-								continue; // not feasible
-							}
-							
-							// is new tour 2 feasible?
-							dTime = 0.0;
-							iCapacity = 0;
-							iLastCustomer = iCustomerCount; // depot
-							iCount = piTempTour2[0];
-
-							for (i=1; i<=iCount; i++)
-							{
-								iNextCustomer = piTempTour2[i];
-
-								// check capacity
-								iCapacity += piCustomerDemand[iNextCustomer];
-
-								if (iCapacity > iMaxCapacity)
-									break; // not feasible
-
-								// check time window
-								dTime +=
-								ppdDistanceMatrix[iLastCustomer][iNextCustomer];
-
-								if (dTime < piCustomerReadyTime[iNextCustomer])
-									dTime = piCustomerReadyTime[iNextCustomer];
-								else if (dTime > piCustomerDueDate[iNextCustomer])
-									break; // not feasible
-
-								dTime += piCustomerServiceTime[iNextCustomer];
-
-								iLastCustomer = iNextCustomer;
-							}
-
-							if (i <= iCount)
-								continue; // not feasible
-
-							if (ppdDistanceMatrix[iLastCustomer][iCustomerCount]
-								+ dTime > iDepotDueDate)
-							{
-								continue; // not feasible
-							}
-							
-							// feasible solution
-							dBestDistDiff = dDistDiff1 + dDistDiff2;
-							iBestX1 = iX1;
-							iBestX2 = iX2;
-							iBestY1 = iY1;
-							iBestY2 = iY2;
-						}
+						applyCrossMoveToState(iRoute1, iRoute2, &Move,
+							ppiTourMatrix, pState);
+
+						bChanged = true;
 					}
 				}
 			}
-
-			// better solution found?
-			if (dBestDistDiff < 0.0)
-			{
-				// build new tours
-				ls_cross_exchange_tour(iBestX1, iBestX2, iBestY1, iBestY2,
-					iCustomerCount1, iCustomerCount2,  ppiTourMatrix[iRoute1],
-					ppiTourMatrix[iRoute2], piTempTour1, piTempTour2);
-
-				IntCopy(ppiTourMatrix[iRoute1], piTempTour1, piTempTour1[0]+1);
-				IntCopy(ppiTourMatrix[iRoute2], piTempTour2, piTempTour2[0]+1);
-
-				dTotalDistance += dBestDistDiff;
-			}
 		}
+
+		endLocalSearchPass(LS_CROSS_EXCHANGE, iVehicleCount, pState);
 	}
+	while (bChanged);
 
 	*pdTotalDistance = dTotalDistance;
 
 	// cleanup
-	free(piTempTour1);
-	free(piTempTour2);
+	pArena->release(iMark);
 
 	return 0;
 }
 
-void Vrptw::ls_cross_exchange_tour(int iX1,
-								   int iX2,
-								   int iY1,
-								   int iY2,
-								   int iCustomerCount1,
-								   int iCustomerCount2,
-								   int *piTour1,
-								   int *piTour2,
-								   int *piTempTour1,
-								   int *piTempTour2)
+// Evaluates all route pairs on the worker pool and keeps the best move of
+// every pair. Each round applies the best moves which don't share a route
+// and re-evaluates only the pairs whose routes were changed, until no
+// improving move is left.
+//
+int Vrptw::ls_cross_exchange_matrix_parallel(int iVehicleCount,
+											 double *pdTotalDistance,
+											 int **ppiTourMatrix,
+											 bool *pbAbort,
+											 LS_STATE_t *pState)
 {
-	int i, j;
+	bool bAbort;
+	int i, iRet, iCustomerCount, iPairCount, iMoveCount, iMark;
+	int iRoute1, iRoute2;
+	double dTotalDistance;
+	bool *pbRouteChanged;
+	int *piPairs, *piJobs, *piTempTour1, *piTempTour2;
+	char *pScratch;
+	CROSS_MOVE_t *pMoves, *pSortedMoves;
+	ROUTE_SUMMARY_t *pSummaries;
+	LS_JOBS_t Jobs;
+	WorkerPool *pPool;
+	ScratchArena *pArena;
 
-	// Tour 1
-	i = 1;
+	if (pbAbort == NULL)
+	{
+		bAbort = false;
+		pbAbort = &bAbort;
+	}
 
-	for (j=1; j<=iX1; j++)
-		piTempTour1[i++] = piTour1[j];
+	// check params
+	if (m_pInstanceData == NULL)
+		return -1;
 
-	// cross X
-	for (j=iX2+1; j<=iY2; j++)
-		piTempTour1[i++] = piTour2[j];
+	if (iVehicleCount < 2)
+		return 0;
 
-	// cross Y
-	for (j=iY1+1; j<=iCustomerCount1; j++)
-		piTempTour1[i++] = piTour1[j];
+	pPool = getLocalSearchPool(pState);
 
-	piTempTour1[0] = i - 1;
+	if (pPool == NULL)
+		return -1;
 
-	// Tour2
-	i = 1;
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+	iPairCount = iVehicleCount * (iVehicleCount-1) / 2;
+	dTotalDistance = *pdTotalDistance;
 
-	for (j=1; j<=iX2; j++)
-		piTempTour2[i++] = piTour2[j];
+	// allocate memory
+	pArena = getScratchArena(iVehicleCount, pState);
+	iMark = pArena->getMark();
+
+	pScratch = (char*)pArena->alloc(getRoutePairScheduleSize()
+		* m_iLocalSearchThreads);
+	pMoves = (CROSS_MOVE_t*)pArena->alloc(sizeof(CROSS_MOVE_t)*iPairCount);
+	pSortedMoves = (CROSS_MOVE_t*)pArena->alloc(sizeof(CROSS_MOVE_t)*iPairCount);
+	piPairs = (int*)pArena->alloc(sizeof(int)*iPairCount*2);
+	piJobs = (int*)pArena->alloc(sizeof(int)*iPairCount);
+	piTempTour1 = (int*)pArena->alloc(sizeof(int)*(iCustomerCount+1));
+	piTempTour2 = (int*)pArena->alloc(sizeof(int)*(iCustomerCount+1));
+	pbRouteChanged = (bool*)pArena->alloc(sizeof(bool)*iVehicleCount);
+	pSummaries = (ROUTE_SUMMARY_t*)pArena->alloc(sizeof(ROUTE_SUMMARY_t)
+		* iVehicleCount);
+
+	if (pScratch == NULL
+		|| pMoves == NULL
+		|| pSortedMoves == NULL
+		|| piPairs == NULL
+		|| piJobs == NULL
+		|| piTempTour1 == NULL
+		|| piTempTour2 == NULL
+		|| pbRouteChanged == NULL
+		|| pSummaries == NULL)
+	{
+		iRet = -1;
+	}
+	else
+		iRet = 0;
 
-	// cross X
-	for (j=iX1+1; j<=iY1; j++)
-		piTempTour2[i++] = piTour1[j];
+	// all route pairs, every route is new
+	i = 0;
 
-	// cross Y
-	for (j=iY2+1; j<=iCustomerCount2; j++)
-		piTempTour2[i++] = piTour2[j];
+	for (iRoute1=0; iRoute1<iVehicleCount-1 && iRet == 0; iRoute1++)
+	{
+		for (iRoute2=iRoute1+1; iRoute2<iVehicleCount; iRoute2++)
+		{
+			piPairs[i*2] = iRoute1;
+			piPairs[i*2+1] = iRoute2;
+			pMoves[i].dDistDiff = 0.0;
+			i++;
+		}
+	}
 
-	piTempTour2[0] = i - 1;
-}
+	// without a state every route is new
+	for (i=0; i<iVehicleCount && iRet == 0; i++)
+	{
+		pbRouteChanged[i] = isRouteDirty(LS_CROSS_EXCHANGE, i, pState);
+	}
 
-int Vrptw::ls_intra_exchange(int iVehicleCount,
-							 double *pdTotalDistance,
-							 int *piTours,
-							 bool *pbAbort)
-{
-	bool bSetSolution;
-	int iRet, iCustomerCount;
-	double dTotalDistance;
-	int **ppiTourMatrix;
+	Jobs.pVrptw = this;
+	Jobs.ppiTourMatrix = ppiTourMatrix;
+	Jobs.pbAbort = pbAbort;
+	Jobs.piPairs = piPairs;
+	Jobs.piJobs = piJobs;
+	Jobs.pMoves = pMoves;
+	Jobs.pScratch = pScratch;
+	Jobs.iScratchSize = getRoutePairScheduleSize();
+	Jobs.pdDistDiff = NULL;
+	Jobs.pbDontLook = NULL;
+
+	while (iRet == 0)
+	{
+		for (i=0; i<iVehicleCount; i++)
+		{
+			if (pbRouteChanged[i])
+				calcRouteSummary(ppiTourMatrix[i], &pSummaries[i]);
+		}
 
-	// check params
-	if (m_pInstanceData == NULL)
-		return -1;
+		// evaluate the promising pairs with a changed route
+		Jobs.iJobCount = 0;
+		Jobs.iAborted = 0;
 
-	iCustomerCount = m_pInstanceData->getCustomerCount();
+		for (i=0; i<iPairCount; i++)
+		{
+			iRoute1 = piPairs[i*2];
+			iRoute2 = piPairs[i*2+1];
 
-	// use stored solution?
-	if (iVehicleCount == 0 || pdTotalDistance == NULL || piTours == NULL)
-	{
-		pdTotalDistance = &dTotalDistance;
-		piTours = m_pInstanceData->getSolutionTours(&iVehicleCount,
-			pdTotalDistance);
+			if (pbRouteChanged[iRoute1] == false
+				&& pbRouteChanged[iRoute2] == false)
+			{
+				continue;
+			}
 
-		if (piTours == NULL)
-			return -1;
+			if (isRoutePairPromising(&pSummaries[iRoute1], &pSummaries[iRoute2]))
+				piJobs[Jobs.iJobCount++] = i;
+			else
+				pMoves[i].dDistDiff = 0.0;
+		}
 
-		bSetSolution = true;
-	}
-	else
-		bSetSolution = false;
+		pPool->run(Jobs.iJobCount, ls_cross_exchange_job, (void*)&Jobs);
 
-	// allocate memory
-	ppiTourMatrix = generate_int_matrix(iVehicleCount, iCustomerCount+1);
-	
-	if (ppiTourMatrix == NULL)
-		return -1;
-	
-	// copy tours to tour matrix
-	convertToTourMatrix(iVehicleCount, piTours, ppiTourMatrix);
+		if (IntAtomicLoad(&Jobs.iAborted) != 0 || *pbAbort)
+		{
+			iRet = -1;
+			break;
+		}
 
-	// do intra exchange
-	iRet = ls_intra_exchange_matrix(iVehicleCount, pdTotalDistance,
-		ppiTourMatrix, NULL);
+		// sort the improving moves, best first
+		iMoveCount = 0;
 
-	if (iRet == 0)
-	{
-		// copy tour matrix to tours
-		convertFromTourMatrix(iVehicleCount, piTours, ppiTourMatrix);
+		for (i=0; i<iPairCount; i++)
+		{
+			if (pMoves[i].dDistDiff < -LS_MIN_IMPROVEMENT)
+				pSortedMoves[iMoveCount++] = pMoves[i];
+		}
 
-		if (bSetSolution)
+		if (iMoveCount == 0)
+			break; // local optimum
+
+		qsort(pSortedMoves, iMoveCount, sizeof(CROSS_MOVE_t), compareCrossMoves);
+
+		// apply the moves which don't share a route
+		for (i=0; i<iVehicleCount; i++)
+			pbRouteChanged[i] = false;
+
+		for (i=0; i<iMoveCount; i++)
 		{
-			m_pInstanceData->setSolutionVehicleCount(iVehicleCount);
-			m_pInstanceData->setSolutionDistance(*pdTotalDistance);
+			iRoute1 = pSortedMoves[i].iRoute1;
+			iRoute2 = pSortedMoves[i].iRoute2;
+
+			if (pbRouteChanged[iRoute1] || pbRouteChanged[iRoute2])
+				continue;
+
+			ls_cross_exchange_tour(pSortedMoves[i].iX1, pSortedMoves[i].iX2,
+				pSortedMoves[i].iY1, pSortedMoves[i].iY2,
+				ppiTourMatrix[iRoute1][0], ppiTourMatrix[iRoute2][0],
+				ppiTourMatrix[iRoute1], ppiTourMatrix[iRoute2],
+				piTempTour1, piTempTour2);
+
+			IntCopy(ppiTourMatrix[iRoute1], piTempTour1, piTempTour1[0]+1);
+			IntCopy(ppiTourMatrix[iRoute2], piTempTour2, piTempTour2[0]+1);
+
+			dTotalDistance += pSortedMoves[i].dDistDiff;
+
+			if (pState != NULL)
+			{
+				applyCrossMoveToState(iRoute1, iRoute2, &pSortedMoves[i],
+					ppiTourMatrix, pState);
+			}
+
+			pbRouteChanged[iRoute1] = true;
+			pbRouteChanged[iRoute2] = true;
 		}
 	}
 
-	// free memory
-	free(ppiTourMatrix);
+	// all route pairs are examined
+	if (iRet == 0 && pState != NULL)
+	{
+		for (i=0; i<iVehicleCount; i++)
+			pState->pbRouteDirty[LS_CROSS_EXCHANGE][i] = false;
+	}
+
+	// final solution check
+	if (iRet == 0
+		&& checkTourMatrix(iVehicleCount, ppiTourMatrix, &dTotalDistance,
+						   pArena) == false)
+	{
+		iRet = -1;
+	}
+
+	// the moves applied so far stay in the tours, also after an abort
+	*pdTotalDistance = dTotalDistance;
+
+	// cleanup
+	pArena->release(iMark);
 
 	return iRet;
 }
 
-int Vrptw::ls_intra_exchange_matrix(int iVehicleCount,
-									double *pdTotalDistance,
-									int **ppiTourMatrix,
-									bool *pbAbort)
+void Vrptw::ls_cross_exchange_job(void *pArg, int iJob, int iThread)
 {
-	int i, j, k;
-	int iRoute, iCustomerCount, iRouteCustomerCount;
-	int iCurr1, iCurr2, iPrev1, iPrev2, iNext1, iNext2;
-	int *piCustomerReadyTime, *piCustomerDueDate, *piCustomerServiceTime;
-	int iLastCustomer, iNextCustomer, iDepotDueDate;
-	double **ppdDistanceMatrix;
-	double dDistDiff, dTime, dTotalDistance;
-	bool bSwapped, bAbort;
+	int iPair;
+	LS_JOBS_t *pJobs;
 
-	if (pbAbort == NULL)
+	pJobs = (LS_JOBS_t *)pArg;
+	iPair = pJobs->piJobs[iJob];
+
+	if (pJobs->pVrptw->ls_cross_exchange_route_pair(
+			pJobs->ppiTourMatrix[pJobs->piPairs[iPair*2]],
+			pJobs->ppiTourMatrix[pJobs->piPairs[iPair*2+1]],
+			pJobs->pScratch + iThread * pJobs->iScratchSize,
+			pJobs->pbAbort, &pJobs->pMoves[iPair]) != 0)
 	{
-		bAbort = false;
-		pbAbort = &bAbort;
+		IntAtomicStore(&pJobs->iAborted, 1);
 	}
 
-	dTotalDistance = *pdTotalDistance;
+	pJobs->pMoves[iPair].iRoute1 = pJobs->piPairs[iPair*2];
+	pJobs->pMoves[iPair].iRoute2 = pJobs->piPairs[iPair*2+1];
+}
 
-	iCustomerCount = m_pInstanceData->getCustomerCount();
-	iDepotDueDate = m_pInstanceData->getDepotDueDate();
+int Vrptw::compareCrossMoves(const void *pMove1, const void *pMove2)
+{
+	const CROSS_MOVE_t *pCrossMove1 = (const CROSS_MOVE_t *)pMove1;
+	const CROSS_MOVE_t *pCrossMove2 = (const CROSS_MOVE_t *)pMove2;
+
+	if (pCrossMove1->dDistDiff < pCrossMove2->dDistDiff)
+		return -1;
 
+	if (pCrossMove1->dDistDiff > pCrossMove2->dDistDiff)
+		return 1;
+
+	// same gain, keep the order of the route pairs
+	if (pCrossMove1->iRoute1 != pCrossMove2->iRoute1)
+		return pCrossMove1->iRoute1 - pCrossMove2->iRoute1;
+
+	return pCrossMove1->iRoute2 - pCrossMove2->iRoute2;
+}
+
+void Vrptw::calcRouteSummary(int *piTour,
+							 ROUTE_SUMMARY_t *pSummary)
+{
+	int i, iCustomer;
+	int *piCustomerXCoord, *piCustomerYCoord;
+	int *piCustomerReadyTime, *piCustomerDueDate, *piCustomerServiceTime;
+	double dTime;
+
+	piCustomerXCoord = m_pInstanceData->getCustomerXCoord();
+	piCustomerYCoord = m_pInstanceData->getCustomerYCoord();
 	piCustomerReadyTime = m_pInstanceData->getCustomerReadyTime();
 	piCustomerDueDate = m_pInstanceData->getCustomerDueDate();
 	piCustomerServiceTime = m_pInstanceData->getCustomerServiceTime();
-	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
 
-	for (iRoute=0; iRoute<iVehicleCount; iRoute++)
-	{
-		iRouteCustomerCount = ppiTourMatrix[iRoute][0];
+	pSummary->iMinXCoord = 0;
+	pSummary->iMaxXCoord = 0;
+	pSummary->iMinYCoord = 0;
+	pSummary->iMaxYCoord = 0;
+	pSummary->dFirstDeparture = 0.0;
+	pSummary->iLatestDueDate = -1;
 
-		bSwapped = true;
+	if (piTour[0] == 0)
+		return;
 
-		while (bSwapped)
-		{
-			bSwapped = false;
+	iCustomer = piTour[1];
 
-			for (i=1; i<iRouteCustomerCount; i++)
-			{
-				for (j=i+1; j<=iRouteCustomerCount; j++)
-				{
-					if (*pbAbort)
-						return -1;
+	pSummary->iMinXCoord = piCustomerXCoord[iCustomer];
+	pSummary->iMaxXCoord = piCustomerXCoord[iCustomer];
+	pSummary->iMinYCoord = piCustomerYCoord[iCustomer];
+	pSummary->iMaxYCoord = piCustomerYCoord[iCustomer];
 
-					iCurr1 = ppiTourMatrix[iRoute][i];
-					iCurr2 = ppiTourMatrix[iRoute][j];
+	dTime = m_pInstanceData->getDepotDistance(iCustomer);
 
-					if (i == 1)
-						iPrev1 = iCustomerCount; // depot
-					else
-						iPrev1 = ppiTourMatrix[iRoute][i-1];
+	if (dTime < piCustomerReadyTime[iCustomer])
+		dTime = piCustomerReadyTime[iCustomer];
 
-					iNext1 = ppiTourMatrix[iRoute][i+1];
-					iPrev2 = ppiTourMatrix[iRoute][j-1];
+	pSummary->dFirstDeparture = dTime + piCustomerServiceTime[iCustomer];
 
-					if (j == iRouteCustomerCount)
-						iNext2 = iCustomerCount; // depot
-					else
-						iNext2 = ppiTourMatrix[iRoute][j+1];
+	for (i=2; i<=piTour[0]; i++)
+	{
+		iCustomer = piTour[i];
 
-					 // new dist
-					dDistDiff = ppdDistanceMatrix[iPrev1][iCurr2];
-					dDistDiff += ppdDistanceMatrix[iCurr2][iNext1];
-					dDistDiff += ppdDistanceMatrix[iPrev2][iCurr1];
-					dDistDiff += ppdDistanceMatrix[iCurr1][iNext2];
+		if (piCustomerXCoord[iCustomer] < pSummary->iMinXCoord)
+			pSummary->iMinXCoord = piCustomerXCoord[iCustomer];
 
-					// old dist
-					dDistDiff -= ppdDistanceMatrix[iPrev1][iCurr1];
+		if (piCustomerXCoord[iCustomer] > pSummary->iMaxXCoord)
+			pSummary->iMaxXCoord = piCustomerXCoord[iCustomer];
 
-					if (i + 1 != j) // customers are not 'neighbors'
-					{
-						dDistDiff -= ppdDistanceMatrix[iCurr1][iNext1];
-						dDistDiff -= ppdDistanceMatrix[iPrev2][iCurr2];
-					}
+		if (piCustomerYCoord[iCustomer] < pSummary->iMinYCoord)
+			pSummary->iMinYCoord = piCustomerYCoord[iCustomer];
 
-					dDistDiff -= ppdDistanceMatrix[iCurr2][iNext2];
+		if (piCustomerYCoord[iCustomer] > pSummary->iMaxYCoord)
+			pSummary->iMaxYCoord = piCustomerYCoord[iCustomer];
 
-					if (dDistDiff >= 0.0)
-						continue;
+		if (piCustomerDueDate[iCustomer] > pSummary->iLatestDueDate)
+			pSummary->iLatestDueDate = piCustomerDueDate[iCustomer];
+	}
+}
 
-					// check time windows
-					dTime = 0.0;
-					iLastCustomer = iCustomerCount; // depot
+// false if no cross exchange between the routes can be feasible or the
+// routes are too far apart; the exchanged segments start at position 2,
+// so they must be served after the first customer of the other route
+//
+bool Vrptw::isRoutePairPromising(const ROUTE_SUMMARY_t *pSummary1,
+								 const ROUTE_SUMMARY_t *pSummary2)
+{
+	int iDistX, iDistY;
 
-					for (k=1; k<=iRouteCustomerCount; k++)
-					{
-						if (k == i)
-							iNextCustomer = iCurr2;
-						else if (k == j)
-							iNextCustomer = iCurr1;
-						else
-							iNextCustomer = ppiTourMatrix[iRoute][k];
+	// time spans don't interleave
+	if (pSummary1->iLatestDueDate < pSummary2->dFirstDeparture
+		|| pSummary2->iLatestDueDate < pSummary1->dFirstDeparture)
+	{
+		return false;
+	}
 
-						dTime += ppdDistanceMatrix[iLastCustomer][iNextCustomer];
+	if (m_dCrossMaxRouteDistance <= 0.0)
+		return true;
 
-						if (dTime < piCustomerReadyTime[iNextCustomer])
-							dTime = piCustomerReadyTime[iNextCustomer];
-						else if (dTime > piCustomerDueDate[iNextCustomer])
-							break; // not feasible
+	// distance of the bounding boxes
+	iDistX = 0;
+	iDistY = 0;
 
-						dTime += piCustomerServiceTime[iNextCustomer];
+	if (pSummary2->iMinXCoord > pSummary1->iMaxXCoord)
+		iDistX = pSummary2->iMinXCoord - pSummary1->iMaxXCoord;
+	else if (pSummary1->iMinXCoord > pSummary2->iMaxXCoord)
+		iDistX = pSummary1->iMinXCoord - pSummary2->iMaxXCoord;
 
-						iLastCustomer = iNextCustomer;
-					}
+	if (pSummary2->iMinYCoord > pSummary1->iMaxYCoord)
+		iDistY = pSummary2->iMinYCoord - pSummary1->iMaxYCoord;
+	else if (pSummary1->iMinYCoord > pSummary2->iMaxYCoord)
+		iDistY = pSummary1->iMinYCoord - pSummary2->iMaxYCoord;
 
-					if (k <= iRouteCustomerCount)
-						continue;	// not feasible
+	return (double)iDistX*iDistX + (double)iDistY*iDistY
+		<= m_dCrossMaxRouteDistance * m_dCrossMaxRouteDistance;
+}
 
-					if (dTime + ppdDistanceMatrix[iLastCustomer][iCustomerCount]
-						> iDepotDueDate)
-					{
-						continue; // not feasible
-					}
-					
-					// swap customers
-					ppiTourMatrix[iRoute][i] = iCurr2;
-					ppiTourMatrix[iRoute][j] = iCurr1;
-					dTotalDistance += dDistDiff;
+// best cross exchange between two tours, pMove->dDistDiff is 0.0 if there
+// is no feasible improvement
+//
+// The arrival times of the segment moved into tour 1 don't depend on Y1,
+// they are computed once per X1/X2. For every Y1 the distance deltas of
+// all Y2 are filtered at once, only the survivors are checked for
+// capacity and time windows.
+//
+int Vrptw::ls_cross_exchange_route_pair(int *piTour1,
+										int *piTour2,
+										char *pSchedule,
+										bool *pbAbort,
+										CROSS_MOVE_t *pMove)
+{
+	bool bAbort;
+	int i, iMaxCapacity, iMaxY1, iMaxY2, iCandidateCount;
+	int iX1, iX2, iY1, iY2, iBestX1, iBestX2, iBestY1, iBestY2;
+	int iLastCustomer1, iLastCustomer2, iCustomerCount;
+	int iCustomerCount1, iCustomerCount2;
+	int iCustomerX1_0, iCustomerX2_0, iCustomerY1_0, iCustomerY2_0;
+	int iCustomerX1_1, iCustomerX2_1, iCustomerY1_1, iCustomerY2_1;
+	double dTime1, dTime2, dDistDiff1, dDistDiff2, dBestDistDiff;
+	int *piCustomerReadyTime, *piCustomerDueDate, *piCustomerServiceTime;
+	int *piLoad1, *piLoad2, *piNext2, *piCandidates;
+	double *pdDeparture1, *pdDeparture2;
+	double *pdLatestArrival1, *pdLatestArrival2;
+	double *pdTime1, *pdArc2, *pdCandidateDistDiff;
+	double **ppdDistanceMatrix;
 
-					bSwapped = true;
-					break;
-				}
+	if (pbAbort == NULL)
+	{
+		bAbort = false;
+		pbAbort = &bAbort;
+	}
 
-				if (bSwapped)
-					break;
+	pMove->dDistDiff = 0.0;
+
+	iCustomerCount1 = piTour1[0];
+	iCustomerCount2 = piTour2[0];
+
+	if (iCustomerCount1 < 2 || iCustomerCount2 < 2)
+		return 0;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+	iMaxCapacity = m_pInstanceData->getCapacity();
+
+	piCustomerReadyTime = m_pInstanceData->getCustomerReadyTime();
+	piCustomerDueDate = m_pInstanceData->getCustomerDueDate();
+	piCustomerServiceTime = m_pInstanceData->getCustomerServiceTime();
+	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+
+	// departure times, latest arrival times and loads of both routes,
+	// arrival times of the segment of tour 2, arcs of tour 2 and the
+	// surviving Y2 of the distance filter
+	pdDeparture1 = (double *)pSchedule;
+	pdDeparture2 = pdDeparture1 + (iCustomerCount+2);
+	pdLatestArrival1 = pdDeparture2 + (iCustomerCount+2);
+	pdLatestArrival2 = pdLatestArrival1 + (iCustomerCount+2);
+	pdTime1 = pdLatestArrival2 + (iCustomerCount+2);
+	pdArc2 = pdTime1 + (iCustomerCount+2);
+	pdCandidateDistDiff = pdArc2 + (iCustomerCount+2);
+	piLoad1 = (int *)(pdCandidateDistDiff + (iCustomerCount+2));
+	piLoad2 = piLoad1 + (iCustomerCount+2);
+	piNext2 = piLoad2 + (iCustomerCount+2);
+	piCandidates = piNext2 + (iCustomerCount+2);
+
+	calcTourSchedule(piTour1, pdDeparture1, pdLatestArrival1, piLoad1);
+	calcTourSchedule(piTour2, pdDeparture2, pdLatestArrival2, piLoad2);
+
+	// successor and arc at every position of tour 2
+	for (i=1; i<=iCustomerCount2; i++)
+	{
+		if (i < iCustomerCount2)
+			piNext2[i] = piTour2[i+1];
+		else
+			piNext2[i] = iCustomerCount; // depot
+
+		pdArc2[i] = ppdDistanceMatrix[piTour2[i]][piNext2[i]];
+	}
+
+	dBestDistDiff = -LS_MIN_IMPROVEMENT;
+	iBestX1 = 0;
+	iBestX2 = 0;
+	iBestY1 = 0;
+	iBestY2 = 0;
+
+	for (iX1 = 1; iX1 < iCustomerCount1; iX1++)
+	{
+		for (iX2 = 1; iX2 < iCustomerCount2; iX2++)
+		{
+			if (*pbAbort)
+				return -1;
+
+			iCustomerX1_0 = piTour1[iX1];
+			iCustomerX1_1 = piTour1[iX1+1];
+			iCustomerX2_0 = piTour2[iX2];
+			iCustomerX2_1 = piTour2[iX2+1];
+
+			// calc dist diff 1 = new1 + new2 - old1 - old2
+			dDistDiff1 = ppdDistanceMatrix[iCustomerX1_0][iCustomerX2_1];
+			dDistDiff1 += ppdDistanceMatrix[iCustomerX2_0][iCustomerX1_1];
+			dDistDiff1 -= ppdDistanceMatrix[iCustomerX1_0][iCustomerX1_1];
+			dDistDiff1 -= ppdDistanceMatrix[iCustomerX2_0][iCustomerX2_1];
+
+			if (dDistDiff1 >= 0.0)
+				continue;
+
+			// bound the length of the exchanged segments
+			iMaxY1 = iCustomerCount1;
+			iMaxY2 = iCustomerCount2;
+
+			if (m_iCrossMaxSegmentLength > 0)
+			{
+				if (iMaxY1 > iX1 + m_iCrossMaxSegmentLength)
+					iMaxY1 = iX1 + m_iCrossMaxSegmentLength;
+
+				if (iMaxY2 > iX2 + m_iCrossMaxSegmentLength)
+					iMaxY2 = iX2 + m_iCrossMaxSegmentLength;
+			}
+
+			// new tour 1 = tour1[1..X1] + tour2[X2+1..Y2] + tour1[Y1+1..]
+			dTime1 = pdDeparture1[iX1];
+			iLastCustomer1 = iCustomerX1_0;
+
+			for (iY2 = iX2+1; iY2 <= iMaxY2; iY2++)
+			{
+				iCustomerY2_0 = piTour2[iY2];
+
+				// append Y2 to the segment moved into tour 1
+				dTime1 += ppdDistanceMatrix[iLastCustomer1][iCustomerY2_0];
+
+				if (dTime1 < piCustomerReadyTime[iCustomerY2_0])
+					dTime1 = piCustomerReadyTime[iCustomerY2_0];
+				else if (dTime1 > piCustomerDueDate[iCustomerY2_0])
+					break; // not feasible, longer segments neither
+
+				dTime1 += piCustomerServiceTime[iCustomerY2_0];
+				iLastCustomer1 = iCustomerY2_0;
+
+				pdTime1[iY2] = dTime1;
+			}
+
+			iMaxY2 = iY2-1;
+
+			if (iMaxY2 <= iX2)
+				continue;
+
+			// new tour 2 = tour2[1..X2] + tour1[X1+1..Y1] + tour2[Y2+1..]
+			dTime2 = pdDeparture2[iX2];
+			iLastCustomer2 = iCustomerX2_0;
+
+			for (iY1 = iX1+1; iY1 <= iMaxY1; iY1++)
+			{
+				iCustomerY1_0 = piTour1[iY1];
+
+				if (iY1 < iCustomerCount1)
+					iCustomerY1_1 = piTour1[iY1+1];
+				else
+					iCustomerY1_1 = iCustomerCount; // depot
+
+				// append Y1 to the segment moved into tour 2
+				dTime2 += ppdDistanceMatrix[iLastCustomer2][iCustomerY1_0];
+
+				if (dTime2 < piCustomerReadyTime[iCustomerY1_0])
+					dTime2 = piCustomerReadyTime[iCustomerY1_0];
+				else if (dTime2 > piCustomerDueDate[iCustomerY1_0])
+					break; // not feasible, longer segments neither
+
+				dTime2 += piCustomerServiceTime[iCustomerY1_0];
+				iLastCustomer2 = iCustomerY1_0;
+
+				// dist diff 2 of all Y2, only improving ones are kept
+				iCandidateCount = ls_cross_exchange_filter(
+					ppdDistanceMatrix[iCustomerY1_0],
+					ppdDistanceMatrix[iCustomerY1_1],
+					ppdDistanceMatrix[iCustomerY1_0][iCustomerY1_1],
+					piTour2, piNext2, pdArc2, iX2+1, iMaxY2,
+					dBestDistDiff - dDistDiff1, pbAbort,
+					piCandidates, pdCandidateDistDiff);
+
+				if (iCandidateCount < 0)
+					return -1;
+
+				for (i=0; i<iCandidateCount; i++)
+				{
+					iY2 = piCandidates[i];
+					dDistDiff2 = pdCandidateDistDiff[i];
+
+					iCustomerY2_0 = piTour2[iY2];
+					iCustomerY2_1 = piNext2[iY2];
+
+					// better solution found?
+					if (dBestDistDiff <= dDistDiff1+dDistDiff2)
+						continue;
+
+					// check capacity of new tour 1 and new tour 2
+					if (piLoad1[iX1] + piLoad2[iY2] - piLoad2[iX2]
+						+ piLoad1[iCustomerCount1] - piLoad1[iY1]
+						> iMaxCapacity)
+					{
+						continue; // not feasible
+					}
+
+					if (piLoad2[iX2] + piLoad1[iY1] - piLoad1[iX1]
+						+ piLoad2[iCustomerCount2] - piLoad2[iY2]
+						> iMaxCapacity)
+					{
+						continue; // not feasible
+					}
+
+					// is the rest of new tour 1 feasible?
+					if (pdTime1[iY2]
+						+ ppdDistanceMatrix[iCustomerY2_0][iCustomerY1_1]
+						> pdLatestArrival1[iY1+1])
+					{
+						continue; // not feasible
+					}
+
+					// is the rest of new tour 2 feasible?
+					if (dTime2
+						+ ppdDistanceMatrix[iCustomerY1_0][iCustomerY2_1]
+						> pdLatestArrival2[iY2+1])
+					{
+						continue; // not feasible
+					}
+
+					// feasible solution
+					dBestDistDiff = dDistDiff1 + dDistDiff2;
+					iBestX1 = iX1;
+					iBestX2 = iX2;
+					iBestY1 = iY1;
+					iBestY2 = iY2;
+				}
 			}
 		}
 	}
 
-	*pdTotalDistance = dTotalDistance;
+	// better solution found?
+	if (dBestDistDiff < -LS_MIN_IMPROVEMENT)
+	{
+		pMove->iX1 = iBestX1;
+		pMove->iX2 = iBestX2;
+		pMove->iY1 = iBestY1;
+		pMove->iY2 = iBestY2;
+		pMove->dDistDiff = dBestDistDiff;
+	}
 
 	return 0;
 }
+
+// dist diff 2 = d(Y1, Y2+1) + d(Y2, Y1+1) - d(Y1, Y1+1) - d(Y2, Y2+1) of
+// Y2 = iFirstY2..iLastY2; keeps the Y2 with a dist diff <= 0.0 and below
+// dBound. d(Y2, Y1+1) is read from the row of Y1+1, the distance matrix
+// is symmetric. returns the number of kept Y2 or -1 if aborted.
+//
+int Vrptw::ls_cross_exchange_filter(const double *pdRowY1,
+									const double *pdRowY1Next,
+									double dArcY1,
+									const int *piTour2,
+									const int *piNext2,
+									const double *pdArc2,
+									int iFirstY2,
+									int iLastY2,
+									double dBound,
+									bool *pbAbort,
+									int *piCandidates,
+									double *pdDistDiff)
+{
+	int iY2, iCount;
+	double dDistDiff;
+#ifdef __AVX2__
+	int k, iMask;
+	double pdDelta[4];
+	__m256d vDelta, vArcY1, vZero, vBound, vAll;
+#endif
+
+	iCount = 0;
+	iY2 = iFirstY2;
+
+#ifdef __AVX2__
+	// four Y2 at a time: gather both rows, compare, compress. the masked
+	// gather with a zero source leaves no lane undefined
+	vArcY1 = _mm256_set1_pd(dArcY1);
+	vZero = _mm256_setzero_pd();
+	vBound = _mm256_set1_pd(dBound);
+	vAll = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+	for (; iY2+3 <= iLastY2; iY2+=4)
+	{
+		if (*pbAbort)
+			return -1;
+
+		vDelta = _mm256_add_pd(
+			_mm256_mask_i32gather_pd(vZero, pdRowY1,
+				_mm_loadu_si128((const __m128i *)(piNext2+iY2)), vAll, 8),
+			_mm256_mask_i32gather_pd(vZero, pdRowY1Next,
+				_mm_loadu_si128((const __m128i *)(piTour2+iY2)), vAll, 8));
+		vDelta = _mm256_sub_pd(vDelta, vArcY1);
+		vDelta = _mm256_sub_pd(vDelta, _mm256_loadu_pd(pdArc2+iY2));
+
+		iMask = _mm256_movemask_pd(_mm256_and_pd(
+			_mm256_cmp_pd(vDelta, vZero, _CMP_LE_OQ),
+			_mm256_cmp_pd(vDelta, vBound, _CMP_LT_OQ)));
+
+		if (iMask == 0)
+			continue;
+
+		_mm256_storeu_pd(pdDelta, vDelta);
+
+		for (k=0; k<4; k++)
+		{
+			if (iMask & (1 << k))
+			{
+				piCandidates[iCount] = iY2 + k;
+				pdDistDiff[iCount] = pdDelta[k];
+				iCount++;
+			}
+		}
+	}
+#endif
+
+	for (; iY2 <= iLastY2; iY2++)
+	{
+		if (*pbAbort)
+			return -1;
+
+		dDistDiff = pdRowY1[piNext2[iY2]] + pdRowY1Next[piTour2[iY2]];
+		dDistDiff -= dArcY1;
+		dDistDiff -= pdArc2[iY2];
+
+		if (dDistDiff <= 0.0 && dDistDiff < dBound)
+		{
+			piCandidates[iCount] = iY2;
+			pdDistDiff[iCount] = dDistDiff;
+			iCount++;
+		}
+	}
+
+	return iCount;
+}
+
+// departure times (after service), latest arrival times which keep the rest
+// of the tour feasible and accumulated loads for positions 0..count+1
+//
+void Vrptw::calcTourSchedule(int *piTour,
+							 double *pdDeparture,
+							 double *pdLatestArrival,
+							 int *piLoad)
+{
+	int i, iCount, iCustomerCount, iLastCustomer, iNextCustomer;
+	int *piCustomerDemand, *piCustomerReadyTime, *piCustomerDueDate;
+	int *piCustomerServiceTime;
+	double dTime, dLatestArrival;
+	double **ppdDistanceMatrix;
+
+	iCount = piTour[0];
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+
+	piCustomerDemand = m_pInstanceData->getCustomerDemand();
+	piCustomerReadyTime = m_pInstanceData->getCustomerReadyTime();
+	piCustomerDueDate = m_pInstanceData->getCustomerDueDate();
+	piCustomerServiceTime = m_pInstanceData->getCustomerServiceTime();
+	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+
+	// forward: departure times and loads
+	dTime = 0.0;
+	iLastCustomer = iCustomerCount; // depot
+
+	pdDeparture[0] = 0.0;
+	piLoad[0] = 0;
+
+	for (i=1; i<=iCount; i++)
+	{
+		iNextCustomer = piTour[i];
+
+		dTime += ppdDistanceMatrix[iLastCustomer][iNextCustomer];
+
+		if (dTime < piCustomerReadyTime[iNextCustomer])
+			dTime = piCustomerReadyTime[iNextCustomer];
+
+		dTime += piCustomerServiceTime[iNextCustomer];
+
+		pdDeparture[i] = dTime;
+		piLoad[i] = piLoad[i-1] + piCustomerDemand[iNextCustomer];
+
+		iLastCustomer = iNextCustomer;
+	}
+
+	// backward: latest arrival times
+	dLatestArrival = m_pInstanceData->getDepotDueDate();
+	pdLatestArrival[iCount+1] = dLatestArrival;
+	iNextCustomer = iCustomerCount; // depot
+
+	for (i=iCount; i>0; i--)
+	{
+		iLastCustomer = piTour[i];
+
+		dLatestArrival -= ppdDistanceMatrix[iLastCustomer][iNextCustomer];
+		dLatestArrival -= piCustomerServiceTime[iLastCustomer];
+
+		if (dLatestArrival > piCustomerDueDate[iLastCustomer])
+			dLatestArrival = piCustomerDueDate[iLastCustomer];
+
+		// rest of the tour can't be served in time at all
+		if (dLatestArrival < piCustomerReadyTime[iLastCustomer])
+			dLatestArrival = -1.0;
+
+		pdLatestArrival[i] = dLatestArrival;
+		iNextCustomer = iLastCustomer;
+	}
+}
+
+void Vrptw::ls_cross_exchange_tour(int iX1,
+								   int iX2,
+								   int iY1,
+								   int iY2,
+								   int iCustomerCount1,
+								   int iCustomerCount2,
+								   int *piTour1,
+								   int *piTour2,
+								   int *piTempTour1,
+								   int *piTempTour2)
+{
+	int i, j;
+
+	// Tour 1
+	i = 1;
+
+	for (j=1; j<=iX1; j++)
+		piTempTour1[i++] = piTour1[j];
+
+	// cross X
+	for (j=iX2+1; j<=iY2; j++)
+		piTempTour1[i++] = piTour2[j];
+
+	// cross Y
+	for (j=iY1+1; j<=iCustomerCount1; j++)
+		piTempTour1[i++] = piTour1[j];
+
+	piTempTour1[0] = i - 1;
+
+	// Tour2
+	i = 1;
+
+	for (j=1; j<=iX2; j++)
+		piTempTour2[i++] = piTour2[j];
+
+	// cross X
+	for (j=iX1+1; j<=iY1; j++)
+		piTempTour2[i++] = piTour1[j];
+
+	// cross Y
+	for (j=iY2+1; j<=iCustomerCount2; j++)
+		piTempTour2[i++] = piTour2[j];
+
+	piTempTour2[0] = i - 1;
+}
+
+int Vrptw::ls_intra_exchange(int iVehicleCount,
+							 double *pdTotalDistance,
+							 int *piTours,
+							 bool *pbAbort)
+{
+	bool bSetSolution;
+	int iRet, iCustomerCount;
+	double dTotalDistance;
+	int **ppiTourMatrix;
+
+	// check params
+	if (m_pInstanceData == NULL)
+		return -1;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+
+	// use stored solution?
+	if (iVehicleCount == 0 || pdTotalDistance == NULL || piTours == NULL)
+	{
+		pdTotalDistance = &dTotalDistance;
+		piTours = m_pInstanceData->getSolutionTours(&iVehicleCount,
+			pdTotalDistance);
+
+		if (piTours == NULL)
+			return -1;
+
+		bSetSolution = true;
+	}
+	else
+		bSetSolution = false;
+
+	if (prepareRouteCache() != 0)
+		return -1;
+
+	// allocate memory
+	if (prepareScratchArena(ScratchArena::getAllocSize(sizeof(int)
+			* iVehicleCount * (iCustomerCount+1) + sizeof(int *) * iVehicleCount)
+		+ getLocalSearchScratchSize(iVehicleCount)) != 0)
+	{
+		return -1;
+	}
+
+	ppiTourMatrix = m_pScratchArena->allocIntMatrix(iVehicleCount,
+													iCustomerCount+1);
+	
+	if (ppiTourMatrix == NULL)
+		return -1;
+	
+	// copy tours to tour matrix
+	convertToTourMatrix(iVehicleCount, piTours, ppiTourMatrix);
+
+	// do intra exchange
+	if (m_iLocalSearchThreads > 1)
+		iRet = ls_intra_exchange_matrix_parallel(iVehicleCount, pdTotalDistance,
+			ppiTourMatrix, pbAbort);
+	else
+		iRet = ls_intra_exchange_matrix(iVehicleCount, pdTotalDistance,
+			ppiTourMatrix, pbAbort);
+
+	if (iRet == 0)
+	{
+		// copy tour matrix to tours
+		convertFromTourMatrix(iVehicleCount, piTours, ppiTourMatrix);
+
+		if (bSetSolution)
+		{
+			m_pInstanceData->setSolutionVehicleCount(iVehicleCount);
+			m_pInstanceData->setSolutionDistance(*pdTotalDistance);
+		}
+	}
+
+	// free memory
+	m_pScratchArena->release(0);
+
+	return iRet;
+}
+
+int Vrptw::ls_intra_exchange_matrix(int iVehicleCount,
+									double *pdTotalDistance,
+									int **ppiTourMatrix,
+									bool *pbAbort,
+									LS_STATE_t *pState)
+{
+	int iRoute, iMark;
+	double dDistDiff, dTotalDistance;
+	char *pScratch;
+	ScratchArena *pArena;
+
+	// check params
+	if (m_pInstanceData == NULL)
+		return -1;
+
+	dTotalDistance = *pdTotalDistance;
+
+	// allocate memory
+	pArena = getScratchArena(iVehicleCount, pState);
+	iMark = pArena->getMark();
+
+	pScratch = (char*)pArena->alloc(getIntraRouteScratchSize());
+
+	if (pScratch == NULL)
+		return -1;
+
+	for (iRoute=0; iRoute<iVehicleCount; iRoute++)
+	{
+		if (isRouteDirty(LS_INTRA_EXCHANGE, iRoute, pState) == false)
+			continue;
+
+		if (ls_intra_exchange_route_cached(ppiTourMatrix[iRoute], pScratch,
+				&dDistDiff, pbAbort,
+				pState != NULL ? pState->pbDontLook : NULL) != 0)
+		{
+			pArena->release(iMark);
+			return -1;
+		}
+
+		if (dDistDiff < 0.0)
+		{
+			dTotalDistance += dDistDiff;
+
+			if (pState != NULL)
+			{
+				markRouteChanged(iRoute, pState);
+				pState->iMoveCount++;
+			}
+		}
+	}
+
+	// every route is at its local optimum
+	if (pState != NULL)
+	{
+		for (iRoute=0; iRoute<iVehicleCount; iRoute++)
+			pState->pbRouteDirty[LS_INTRA_EXCHANGE][iRoute] = false;
+	}
+
+	*pdTotalDistance = dTotalDistance;
+
+	// cleanup
+	pArena->release(iMark);
+
+	return 0;
+}
+
+// the routes are independent, every route is a job of the worker pool
+int Vrptw::ls_intra_exchange_matrix_parallel(int iVehicleCount,
+											 double *pdTotalDistance,
+											 int **ppiTourMatrix,
+											 bool *pbAbort,
+											 LS_STATE_t *pState)
+{
+	bool bAbort;
+	int iRoute, iRet, iMark;
+	double dTotalDistance;
+	double *pdDistDiff;
+	char *pScratch;
+	LS_JOBS_t Jobs;
+	WorkerPool *pPool;
+	ScratchArena *pArena;
+
+	if (pbAbort == NULL)
+	{
+		bAbort = false;
+		pbAbort = &bAbort;
+	}
+
+	// check params
+	if (m_pInstanceData == NULL)
+		return -1;
+
+	pPool = getLocalSearchPool(pState);
+
+	if (pPool == NULL)
+		return -1;
+
+	// allocate memory
+	pArena = getScratchArena(iVehicleCount, pState);
+	iMark = pArena->getMark();
+
+	pdDistDiff = (double*)pArena->alloc(sizeof(double)*iVehicleCount);
+	pScratch = (char*)pArena->alloc(getIntraRouteScratchSize()
+		* m_iLocalSearchThreads);
+
+	if (pdDistDiff == NULL || pScratch == NULL)
+	{
+		pArena->release(iMark);
+		return -1;
+	}
+
+	Jobs.pVrptw = this;
+	Jobs.ppiTourMatrix = ppiTourMatrix;
+	Jobs.pbAbort = pbAbort;
+	Jobs.iAborted = 0;
+	Jobs.iJobCount = iVehicleCount;
+	Jobs.piPairs = NULL;
+	Jobs.piJobs = NULL;
+	Jobs.pMoves = NULL;
+	Jobs.pScratch = pScratch;	// one per thread
+	Jobs.iScratchSize = getIntraRouteScratchSize();
+	Jobs.pdDistDiff = pdDistDiff;
+
+	// the customers of a route are only touched by its own job
+	if (pState != NULL)
+		Jobs.pbDontLook = pState->pbDontLook;
+	else
+		Jobs.pbDontLook = NULL;
+
+	pPool->run(iVehicleCount, ls_intra_exchange_job, (void*)&Jobs);
+
+	if (IntAtomicLoad(&Jobs.iAborted) != 0 || *pbAbort)
+		iRet = -1;
+	else
+	{
+		dTotalDistance = *pdTotalDistance;
+
+		for (iRoute=0; iRoute<iVehicleCount; iRoute++)
+		{
+			if (pdDistDiff[iRoute] < 0.0)
+			{
+				dTotalDistance += pdDistDiff[iRoute];
+
+				if (pState != NULL)
+				{
+					markRouteChanged(iRoute, pState);
+					pState->iMoveCount++;
+				}
+			}
+		}
+
+		if (pState != NULL)
+		{
+			for (iRoute=0; iRoute<iVehicleCount; iRoute++)
+				pState->pbRouteDirty[LS_INTRA_EXCHANGE][iRoute] = false;
+		}
+
+		// final solution check
+		if (checkTourMatrix(iVehicleCount, ppiTourMatrix, &dTotalDistance,
+							pArena))
+		{
+			*pdTotalDistance = dTotalDistance;
+			iRet = 0;
+		}
+		else
+			iRet = -1;
+	}
+
+	// cleanup
+	pArena->release(iMark);
+
+	return iRet;
+}
+
+void Vrptw::ls_intra_exchange_job(void *pArg, int iJob, int iThread)
+{
+	LS_JOBS_t *pJobs;
+
+	pJobs = (LS_JOBS_t *)pArg;
+
+	if (pJobs->pVrptw->ls_intra_exchange_route_cached(
+			pJobs->ppiTourMatrix[iJob],
+			pJobs->pScratch + iThread * pJobs->iScratchSize,
+			&pJobs->pdDistDiff[iJob], pJobs->pbAbort, pJobs->pbDontLook) != 0)
+	{
+		IntAtomicStore(&pJobs->iAborted, 1);
+	}
+}
+
+// With don't-look bits only swaps with at least one customer whose bit is
+// cleared are examined. The bits of the swapped customers and their
+// neighbors are cleared, all bits of the route are set at the local optimum.
+//
+// In the best-first orders every pass takes the best few improving swaps
+// of the route and checks them for feasibility, best first. Only if none
+// of them is feasible the pass falls back to first improvement.
+//
+int Vrptw::ls_intra_exchange_route(int *piTour,
+								   double *pdArcs,
+								   double *pdDistDiff,
+								   bool *pbAbort,
+								   bool *pbDontLook)
+{
+	int i, j, k, iMoveCount, iAppliedCount;
+	int iCustomerCount, iRouteCustomerCount;
+	int iCurr1, iCurr2, iPrev1, iPrev2, iNext1, iNext2;
+	double **ppdDistanceMatrix;
+	double dDistDiff, dTotalDistDiff;
+	bool bSwapped, bAbort;
+	INTRA_MOVE_t pMoves[LS_INTRA_MAX_CANDIDATES];
+	INTRA_MOVE_t pApplied[LS_INTRA_MAX_CANDIDATES];
+
+	if (pbAbort == NULL)
+	{
+		bAbort = false;
+		pbAbort = &bAbort;
+	}
+
+	dTotalDistDiff = 0.0;
+	*pdDistDiff = 0.0;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+
+	iRouteCustomerCount = piTour[0];
+
+	// nothing to look at?
+	if (pbDontLook != NULL)
+	{
+		for (i=1; i<=iRouteCustomerCount; i++)
+		{
+			if (pbDontLook[piTour[i]] == false)
+				break;
+		}
+
+		if (i > iRouteCustomerCount)
+			return 0;
+	}
+
+	bSwapped = true;
+
+	while (bSwapped)
+	{
+		bSwapped = false;
+
+		if (*pbAbort)
+			return -1;
+
+		if (m_iIntraMoveOrder != LS_INTRA_FIRST_IMPROVEMENT)
+		{
+			iMoveCount = ls_intra_exchange_best_moves(piTour, pdArcs,
+													  pbDontLook, pMoves);
+			iAppliedCount = 0;
+
+			for (k=0; k<iMoveCount; k++)
+			{
+				i = pMoves[k].iPos1;
+				j = pMoves[k].iPos2;
+
+				// the swaps of a pass must not share an arc
+				if (isIntraMoveOverlapping(&pMoves[k], pApplied, iAppliedCount))
+					continue;
+
+				if (isIntraSwapFeasible(piTour, i, j) == false)
+					continue;
+
+				swapIntraCustomers(piTour, i, j, pbDontLook);
+				dTotalDistDiff += pMoves[k].dDistDiff;
+				pApplied[iAppliedCount++] = pMoves[k];
+
+				if (m_iIntraMoveOrder == LS_INTRA_BEST_FIRST)
+					break;
+			}
+
+			if (iAppliedCount > 0)
+			{
+				bSwapped = true;
+				continue;
+			}
+		}
+
+		for (i=1; i<iRouteCustomerCount; i++)
+		{
+			for (j=i+1; j<=iRouteCustomerCount; j++)
+			{
+				if (*pbAbort)
+					return -1;
+
+				iCurr1 = piTour[i];
+				iCurr2 = piTour[j];
+
+				if (pbDontLook != NULL
+					&& pbDontLook[iCurr1]
+					&& pbDontLook[iCurr2])
+				{
+					continue;
+				}
+
+				if (i == 1)
+					iPrev1 = iCustomerCount; // depot
+				else
+					iPrev1 = piTour[i-1];
+
+				iNext1 = piTour[i+1];
+				iPrev2 = piTour[j-1];
+
+				if (j == iRouteCustomerCount)
+					iNext2 = iCustomerCount; // depot
+				else
+					iNext2 = piTour[j+1];
+
+				 // new dist
+				dDistDiff = ppdDistanceMatrix[iPrev1][iCurr2];
+				dDistDiff += ppdDistanceMatrix[iCurr2][iNext1];
+				dDistDiff += ppdDistanceMatrix[iPrev2][iCurr1];
+				dDistDiff += ppdDistanceMatrix[iCurr1][iNext2];
+
+				// old dist
+				dDistDiff -= ppdDistanceMatrix[iPrev1][iCurr1];
+
+				if (i + 1 != j) // customers are not 'neighbors'
+				{
+					dDistDiff -= ppdDistanceMatrix[iCurr1][iNext1];
+					dDistDiff -= ppdDistanceMatrix[iPrev2][iCurr2];
+				}
+
+				dDistDiff -= ppdDistanceMatrix[iCurr2][iNext2];
+
+				if (dDistDiff >= -LS_MIN_IMPROVEMENT)
+					continue;
+
+				if (isIntraSwapFeasible(piTour, i, j) == false)
+					continue;
+
+				swapIntraCustomers(piTour, i, j, pbDontLook);
+				dTotalDistDiff += dDistDiff;
+
+				bSwapped = true;
+				break;
+			}
+
+			if (bSwapped)
+				break;
+		}
+	}
+
+	// local optimum
+	if (pbDontLook != NULL)
+	{
+		for (i=1; i<=iRouteCustomerCount; i++)
+			pbDontLook[piTour[i]] = true;
+	}
+
+	*pdDistDiff = dTotalDistDiff;
+
+	return 0;
+}
+
+// The best improving swaps of the route, best first. For a fixed i the
+// deltas of all j are computed in one pass over the tour and its arcs; the
+// distance matrix is symmetric, so every term is a row of i's neighborhood
+// indexed by the tour.
+//
+int Vrptw::ls_intra_exchange_best_moves(int *piTour,
+										double *pdArcs,
+										bool *pbDontLook,
+										INTRA_MOVE_t *pMoves)
+{
+	int i, j, iCount, iMaxCount, iCustomerCount, iRouteCustomerCount;
+	int iCurr1, iPrev1, iNext1, iCurr2, iNext2;
+	double dDistDiff, dOldDist1;
+	double *pdRowPrev1, *pdRowNext1, *pdRowCurr1;
+	double **ppdDistanceMatrix;
+#ifdef __AVX2__
+	int k, iMask;
+	double pdDelta[4];
+	__m256d vDelta, vSum, vOldDist1, vBound, vZero, vAll;
+#endif
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+
+	iRouteCustomerCount = piTour[0];
+	iMaxCount = m_iIntraCandidates;
+	iCount = 0;
+
+#ifdef __AVX2__
+	// masked gathers with a zero source, no lane is left undefined
+	vZero = _mm256_setzero_pd();
+	vAll = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+#endif
+
+	// arcs of the route, pdArcs[i] = d(i, i+1)
+	pdArcs[0] = ppdDistanceMatrix[iCustomerCount][piTour[1]];
+
+	for (i=1; i<iRouteCustomerCount; i++)
+		pdArcs[i] = ppdDistanceMatrix[piTour[i]][piTour[i+1]];
+
+	pdArcs[iRouteCustomerCount] =
+		ppdDistanceMatrix[piTour[iRouteCustomerCount]][iCustomerCount];
+
+	for (i=1; i<iRouteCustomerCount; i++)
+	{
+		iCurr1 = piTour[i];
+		iNext1 = piTour[i+1];
+
+		if (i == 1)
+			iPrev1 = iCustomerCount; // depot
+		else
+			iPrev1 = piTour[i-1];
+
+		pdRowPrev1 = ppdDistanceMatrix[iPrev1];
+		pdRowNext1 = ppdDistanceMatrix[iNext1];
+		pdRowCurr1 = ppdDistanceMatrix[iCurr1];
+
+		// neighbors: i+1 == j
+		j = i+1;
+
+		if (j == iRouteCustomerCount)
+			iNext2 = iCustomerCount; // depot
+		else
+			iNext2 = piTour[j+1];
+
+		dDistDiff = pdRowPrev1[iNext1];
+		dDistDiff += pdRowCurr1[iNext2];
+		dDistDiff -= pdArcs[i-1];
+		dDistDiff -= pdArcs[j];
+
+		if (pbDontLook == NULL || pbDontLook[iCurr1] == false
+			|| pbDontLook[iNext1] == false)
+		{
+			addIntraMove(i, j, dDistDiff, pMoves, &iCount, iMaxCount);
+		}
+
+		// the rest: d(i-1, j) + d(j, i+1) + d(j-1, i) + d(i, j+1)
+		// - d(i-1, i) - d(i, i+1) - d(j-1, j) - d(j, j+1)
+		dOldDist1 = pdArcs[i-1] + pdArcs[i];
+		j = i+2;
+
+#ifdef __AVX2__
+		vOldDist1 = _mm256_set1_pd(dOldDist1);
+
+		for (; j+3 < iRouteCustomerCount; j+=4)
+		{
+			vSum = _mm256_add_pd(
+				_mm256_mask_i32gather_pd(vZero, pdRowPrev1,
+					_mm_loadu_si128((const __m128i *)(piTour+j)), vAll, 8),
+				_mm256_mask_i32gather_pd(vZero, pdRowNext1,
+					_mm_loadu_si128((const __m128i *)(piTour+j)), vAll, 8));
+			vSum = _mm256_add_pd(vSum,
+				_mm256_mask_i32gather_pd(vZero, pdRowCurr1,
+					_mm_loadu_si128((const __m128i *)(piTour+j-1)), vAll, 8));
+			vSum = _mm256_add_pd(vSum,
+				_mm256_mask_i32gather_pd(vZero, pdRowCurr1,
+					_mm_loadu_si128((const __m128i *)(piTour+j+1)), vAll, 8));
+
+			vDelta = _mm256_sub_pd(vSum, vOldDist1);
+			vDelta = _mm256_sub_pd(vDelta, _mm256_loadu_pd(pdArcs+j-1));
+			vDelta = _mm256_sub_pd(vDelta, _mm256_loadu_pd(pdArcs+j));
+
+			// only deltas which beat the worst kept move
+			if (iCount < iMaxCount)
+				vBound = _mm256_set1_pd(-LS_MIN_IMPROVEMENT);
+			else
+				vBound = _mm256_set1_pd(pMoves[iCount-1].dDistDiff);
+
+			iMask = _mm256_movemask_pd(_mm256_cmp_pd(vDelta, vBound,
+													 _CMP_LT_OQ));
+
+			if (iMask == 0)
+				continue;
+
+			_mm256_storeu_pd(pdDelta, vDelta);
+
+			for (k=0; k<4; k++)
+			{
+				if ((iMask & (1 << k))
+					&& (pbDontLook == NULL || pbDontLook[iCurr1] == false
+						|| pbDontLook[piTour[j+k]] == false))
+				{
+					addIntraMove(i, j+k, pdDelta[k], pMoves, &iCount, iMaxCount);
+				}
+			}
+		}
+#endif
+
+		for (; j<=iRouteCustomerCount; j++)
+		{
+			iCurr2 = piTour[j];
+
+			if (j == iRouteCustomerCount)
+				iNext2 = iCustomerCount; // depot
+			else
+				iNext2 = piTour[j+1];
+
+			dDistDiff = pdRowPrev1[iCurr2] + pdRowNext1[iCurr2];
+			dDistDiff += pdRowCurr1[piTour[j-1]];
+			dDistDiff += pdRowCurr1[iNext2];
+			dDistDiff -= dOldDist1;
+			dDistDiff -= pdArcs[j-1];
+			dDistDiff -= pdArcs[j];
+
+			if (pbDontLook == NULL || pbDontLook[iCurr1] == false
+				|| pbDontLook[iCurr2] == false)
+			{
+				addIntraMove(i, j, dDistDiff, pMoves, &iCount, iMaxCount);
+			}
+		}
+	}
+
+	return iCount;
+}
+
+// keeps the iMaxCount best improving moves sorted by their dist diff
+void Vrptw::addIntraMove(int iPos1,
+						 int iPos2,
+						 double dDistDiff,
+						 INTRA_MOVE_t *pMoves,
+						 int *piCount,
+						 int iMaxCount)
+{
+	int i;
+
+	if (dDistDiff >= -LS_MIN_IMPROVEMENT)
+		return;
+
+	if (*piCount == iMaxCount && dDistDiff >= pMoves[iMaxCount-1].dDistDiff)
+		return;
+
+	if (*piCount < iMaxCount)
+		(*piCount)++;
+
+	for (i=*piCount-1; i>0 && pMoves[i-1].dDistDiff > dDistDiff; i--)
+		pMoves[i] = pMoves[i-1];
+
+	pMoves[i].iPos1 = iPos1;
+	pMoves[i].iPos2 = iPos2;
+	pMoves[i].dDistDiff = dDistDiff;
+}
+
+// true if the swap touches an arc of one of the applied swaps
+bool Vrptw::isIntraMoveOverlapping(const INTRA_MOVE_t *pMove,
+								   const INTRA_MOVE_t *pApplied,
+								   int iAppliedCount)
+{
+	int i;
+
+	for (i=0; i<iAppliedCount; i++)
+	{
+		if (abs(pMove->iPos1 - pApplied[i].iPos1) < 2
+			|| abs(pMove->iPos1 - pApplied[i].iPos2) < 2
+			|| abs(pMove->iPos2 - pApplied[i].iPos1) < 2
+			|| abs(pMove->iPos2 - pApplied[i].iPos2) < 2)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// time windows of the route with the customers at i and j swapped
+bool Vrptw::isIntraSwapFeasible(int *piTour,
+								int i,
+								int j)
+{
+	int k, iCustomerCount, iLastCustomer, iNextCustomer;
+	int *piCustomerReadyTime, *piCustomerDueDate, *piCustomerServiceTime;
+	double dTime;
+	double **ppdDistanceMatrix;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+
+	piCustomerReadyTime = m_pInstanceData->getCustomerReadyTime();
+	piCustomerDueDate = m_pInstanceData->getCustomerDueDate();
+	piCustomerServiceTime = m_pInstanceData->getCustomerServiceTime();
+	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+
+	dTime = 0.0;
+	iLastCustomer = iCustomerCount; // depot
+
+	for (k=1; k<=piTour[0]; k++)
+	{
+		if (k == i)
+			iNextCustomer = piTour[j];
+		else if (k == j)
+			iNextCustomer = piTour[i];
+		else
+			iNextCustomer = piTour[k];
+
+		dTime += ppdDistanceMatrix[iLastCustomer][iNextCustomer];
+
+		if (dTime < piCustomerReadyTime[iNextCustomer])
+			dTime = piCustomerReadyTime[iNextCustomer];
+		else if (dTime > piCustomerDueDate[iNextCustomer])
+			return false;
+
+		dTime += piCustomerServiceTime[iNextCustomer];
+
+		iLastCustomer = iNextCustomer;
+	}
+
+	return dTime + ppdDistanceMatrix[iLastCustomer][iCustomerCount]
+		<= m_pInstanceData->getDepotDueDate();
+}
+
+void Vrptw::swapIntraCustomers(int *piTour,
+							   int i,
+							   int j,
+							   bool *pbDontLook)
+{
+	int iCustomer;
+
+	iCustomer = piTour[i];
+	piTour[i] = piTour[j];
+	piTour[j] = iCustomer;
+
+	if (pbDontLook != NULL)
+	{
+		clearDontLookBits(piTour, i-1, pbDontLook);
+		clearDontLookBits(piTour, i+1, pbDontLook);
+		clearDontLookBits(piTour, j-1, pbDontLook);
+		clearDontLookBits(piTour, j+1, pbDontLook);
+	}
+}
+
+// Routes which were optimized before are taken from the route cache.
+// Otherwise the route is optimized and the result is stored, the temp tour
+// in pScratch keeps the original route in between. Only the result of a
+// search of all customers is stored, under the move order and the
+// candidate count which produced it.
+//
+int Vrptw::ls_intra_exchange_route_cached(int *piTour,
+										  char *pScratch,
+										  double *pdDistDiff,
+										  bool *pbAbort,
+										  bool *pbDontLook)
+{
+	int i, iVariant, iDontLook;
+	bool bFeasible, bFullSearch;
+	double dDistance;
+	int *piTempTour;
+	double *pdArcs;
+
+	// temp tour and arcs of the route
+	piTempTour = (int*)pScratch;
+	pdArcs = (double*)(pScratch + ScratchArena::getAllocSize(sizeof(int)
+		* (m_pInstanceData->getCustomerCount()+1)));
+
+	// the cache is shared by the ants, a hit would depend on their timing
+	if (m_pRouteCache == NULL
+		|| m_pRouteCache->getEntryCount() == 0
+		|| piTour[0] > m_pRouteCache->getMaxRouteLength()
+		|| m_bReproducible)
+	{
+		return ls_intra_exchange_route(piTour, pdArcs, pdDistDiff, pbAbort,
+									   pbDontLook);
+	}
+
+	// with don't look bits set only a part of the route is searched
+	bFullSearch = true;
+
+	if (pbDontLook != NULL)
+	{
+		iDontLook = 0;
+
+		for (i=1; i<=piTour[0]; i++)
+		{
+			if (pbDontLook[piTour[i]])
+				iDontLook++;
+		}
+
+		// local optimum already
+		if (iDontLook == piTour[0])
+		{
+			*pdDistDiff = 0.0;
+			return 0;
+		}
+
+		bFullSearch = (iDontLook == 0);
+	}
+
+	iVariant = m_iIntraMoveOrder * (LS_INTRA_MAX_CANDIDATES+1)
+		+ m_iIntraCandidates;
+
+	if (m_pRouteCache->lookup(piTour, iVariant, piTempTour, &dDistance,
+							  &bFeasible)
+		&& bFeasible)
+	{
+		*pdDistDiff = dDistance - calcTourDistance(piTour);
+		IntCopy(piTour, piTempTour, piTour[0]+1);
+
+		// local optimum
+		if (pbDontLook != NULL)
+		{
+			for (i=1; i<=piTour[0]; i++)
+				pbDontLook[piTour[i]] = true;
+		}
+
+		return 0;
+	}
+
+	IntCopy(piTempTour, piTour, piTour[0]+1);
+
+	if (ls_intra_exchange_route(piTour, pdArcs, pdDistDiff, pbAbort,
+								pbDontLook) != 0)
+	{
+		return -1;
+	}
+
+	if (bFullSearch)
+	{
+		m_pRouteCache->insert(piTempTour, iVariant, piTour,
+							  calcTourDistance(piTour), checkTour(piTour));
+	}
+
+	return 0;
+}
+
+// creates or resizes the route cache, must not be in use. called by the
+// entry points before the searches start, never by the searches
+int Vrptw::prepareRouteCache()
+{
+	int iMaxRouteLength;
+
+	if (m_iRouteCacheSize == 0)
+	{
+		if (m_pRouteCache != NULL)
+			m_pRouteCache->destroy();
+
+		return 0;
+	}
+
+	if (m_pRouteCache == NULL)
+		m_pRouteCache = new RouteCache();
+
+	// longer routes are rarely repeated, they aren't cached
+	iMaxRouteLength = m_pInstanceData->getCustomerCount();
+
+	if (iMaxRouteLength > ROUTE_CACHE_MAX_ROUTE_LENGTH)
+		iMaxRouteLength = ROUTE_CACHE_MAX_ROUTE_LENGTH;
+
+	if (m_pRouteCache->getEntryCount() == m_iRouteCacheSize
+		&& m_pRouteCache->getMaxRouteLength() == iMaxRouteLength)
+	{
+		return 0;
+	}
+
+	return m_pRouteCache->create(m_iRouteCacheSize, iMaxRouteLength);
+}
+
+void Vrptw::getRouteCacheStatistics(long long *pllLookups,
+									long long *pllHits)
+{
+	*pllLookups = 0;
+	*pllHits = 0;
+
+	if (m_pRouteCache != NULL)
+		m_pRouteCache->getStatistics(pllLookups, pllHits);
+}
+
+double Vrptw::calcTourDistance(int *piTour)
+{
+	int i, iCustomerCount, iLastCustomer;
+	double dDistance;
+	double **ppdDistanceMatrix;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+
+	dDistance = 0.0;
+	iLastCustomer = iCustomerCount; // depot
+
+	for (i=1; i<=piTour[0]; i++)
+	{
+		dDistance += ppdDistanceMatrix[iLastCustomer][piTour[i]];
+		iLastCustomer = piTour[i];
+	}
+
+	return dDistance + ppdDistanceMatrix[iLastCustomer][iCustomerCount];
+}
+
+// clears the don't-look bits of the customers at iPos and iPos+1
+void Vrptw::clearDontLookBits(int *piTour,
+							  int iPos,
+							  bool *pbDontLook)
+{
+	if (iPos >= 1 && iPos <= piTour[0])
+		pbDontLook[piTour[iPos]] = false;
+
+	if (iPos+1 >= 1 && iPos+1 <= piTour[0])
+		pbDontLook[piTour[iPos+1]] = false;
+}
+
+// marks both routes of an applied cross exchange as changed and clears the
+// don't-look bits at the borders of the exchanged segments
+//
+void Vrptw::applyCrossMoveToState(int iRoute1,
+								  int iRoute2,
+								  CROSS_MOVE_t *pMove,
+								  int **ppiTourMatrix,
+								  LS_STATE_t *pState)
+{
+	// new tour 1 = tour1[1..X1] + tour2[X2+1..Y2] + tour1[Y1+1..]
+	clearDontLookBits(ppiTourMatrix[iRoute1], pMove->iX1, pState->pbDontLook);
+	clearDontLookBits(ppiTourMatrix[iRoute1],
+		pMove->iX1 + pMove->iY2 - pMove->iX2, pState->pbDontLook);
+
+	// new tour 2 = tour2[1..X2] + tour1[X1+1..Y1] + tour2[Y2+1..]
+	clearDontLookBits(ppiTourMatrix[iRoute2], pMove->iX2, pState->pbDontLook);
+	clearDontLookBits(ppiTourMatrix[iRoute2],
+		pMove->iX2 + pMove->iY1 - pMove->iX1, pState->pbDontLook);
+
+	markRouteChanged(iRoute1, pState);
+	markRouteChanged(iRoute2, pState);
+	pState->iMoveCount++;
+}
+
+// a changed route has to be examined again by every operator
+void Vrptw::markRouteChanged(int iRoute,
+							 LS_STATE_t *pState)
+{
+	int iOperator;
+
+	for (iOperator=0; iOperator<LS_OPERATOR_COUNT; iOperator++)
+		pState->pbRouteDirty[iOperator][iRoute] = true;
+
+	pState->pbRouteChanged[iRoute] = true;
+}
+
+void Vrptw::beginLocalSearchPass(int iVehicleCount,
+								 LS_STATE_t *pState)
+{
+	int i;
+
+	if (pState == NULL)
+		return;
+
+	for (i=0; i<iVehicleCount; i++)
+		pState->pbRouteChanged[i] = false;
+}
+
+// only the routes changed in this pass are dirty for the next one
+void Vrptw::endLocalSearchPass(int iOperator,
+							   int iVehicleCount,
+							   LS_STATE_t *pState)
+{
+	int i;
+
+	if (pState == NULL)
+		return;
+
+	for (i=0; i<iVehicleCount; i++)
+		pState->pbRouteDirty[iOperator][i] = pState->pbRouteChanged[i];
+}
+
+int Vrptw::createLocalSearchState(int iVehicleCount,
+								  LS_STATE_t *pState)
+{
+	int i, iCustomerCount;
+
+	// check params
+	if (m_pInstanceData == NULL || iVehicleCount < 1)
+		return -1;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+
+	// allocate memory, the dirty flags of all operators in one block
+	pState->pbRouteDirty[0] = (bool*)malloc(sizeof(bool)*iVehicleCount
+		* LS_OPERATOR_COUNT);
+	pState->pbRouteChanged = (bool*)malloc(sizeof(bool)*iVehicleCount);
+	pState->pbDontLook = (bool*)malloc(sizeof(bool)*iCustomerCount);
+	pState->pArena = NULL;
+	pState->bSingleThread = false;
+	pState->pPool = NULL;
+
+	if (pState->pbRouteDirty[0] == NULL
+		|| pState->pbRouteChanged == NULL
+		|| pState->pbDontLook == NULL)
+	{
+		freeLocalSearchState(pState);
+		return -1;
+	}
+
+	for (i=1; i<LS_OPERATOR_COUNT; i++)
+		pState->pbRouteDirty[i] = pState->pbRouteDirty[0] + i * iVehicleCount;
+
+	resetLocalSearchState(iVehicleCount, pState);
+
+	return 0;
+}
+
+void Vrptw::freeLocalSearchState(LS_STATE_t *pState)
+{
+	int i;
+
+	if (pState->pbRouteDirty[0] != NULL)
+	{
+		free(pState->pbRouteDirty[0]);
+
+		for (i=0; i<LS_OPERATOR_COUNT; i++)
+			pState->pbRouteDirty[i] = NULL;
+	}
+
+	if (pState->pbRouteChanged != NULL)
+	{
+		free(pState->pbRouteChanged);
+		pState->pbRouteChanged = NULL;
+	}
+
+	if (pState->pbDontLook != NULL)
+	{
+		free(pState->pbDontLook);
+		pState->pbDontLook = NULL;
+	}
+}
+
+// new solution: every route is dirty, every customer has to be looked at
+void Vrptw::resetLocalSearchState(int iVehicleCount,
+								  LS_STATE_t *pState)
+{
+	int i, iOperator, iCustomerCount;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+
+	for (i=0; i<iVehicleCount; i++)
+	{
+		for (iOperator=0; iOperator<LS_OPERATOR_COUNT; iOperator++)
+			pState->pbRouteDirty[iOperator][i] = true;
+
+		pState->pbRouteChanged[i] = false;
+	}
+
+	for (i=0; i<iCustomerCount; i++)
+		pState->pbDontLook[i] = false;
+
+	pState->iMoveCount = 0;
+}
+
+int Vrptw::ls_relocate_matrix(int iVehicleCount,
+							  double *pdTotalDistance,
+							  int **ppiTourMatrix,
+							  bool *pbAbort,
+							  LS_STATE_t *pState)
+{
+	bool bChanged;
+	int iRoute1, iRoute2, iCustomerCount, iMark, iRet;
+	int *piTempTour1, *piTempTour2;
+	SEGMENT_t *pSegments;
+	CROSS_MOVE_t Move;
+	ScratchArena *pArena;
+
+	// check params
+	if (m_pInstanceData == NULL)
+		return -1;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+
+	// allocate memory
+	pArena = getScratchArena(iVehicleCount, pState);
+	iMark = pArena->getMark();
+
+	piTempTour1 = (int *)pArena->alloc(sizeof(int) * (iCustomerCount+1));
+	piTempTour2 = (int *)pArena->alloc(sizeof(int) * (iCustomerCount+1));
+	pSegments = (SEGMENT_t *)pArena->alloc(sizeof(SEGMENT_t)
+		* (iCustomerCount+2) * 4);
+
+	if (piTempTour1 == NULL || piTempTour2 == NULL || pSegments == NULL)
+	{
+		pArena->release(iMark);
+		return -1;
+	}
+
+	iRet = 0;
+
+	do
+	{
+		bChanged = false;
+
+		beginLocalSearchPass(iVehicleCount, pState);
+
+		for (iRoute1=0; iRoute1<iVehicleCount-1 && iRet == 0; iRoute1++)
+		{
+			for (iRoute2=iRoute1+1; iRoute2<iVehicleCount; iRoute2++)
+			{
+				if (pbAbort != NULL && *pbAbort)
+				{
+					iRet = -1;
+					break;
+				}
+
+				// nothing changed since the last examination?
+				if (isRouteDirty(LS_RELOCATE, iRoute1, pState) == false
+					&& isRouteDirty(LS_RELOCATE, iRoute2, pState) == false)
+				{
+					continue;
+				}
+
+				ls_relocate_route_pair(ppiTourMatrix[iRoute1],
+					ppiTourMatrix[iRoute2], pSegments, &Move);
+
+				if (Move.dDistDiff < 0.0
+					&& ls_apply_route_pair_move(iRoute1, iRoute2, &Move,
+						ppiTourMatrix, piTempTour1, piTempTour2, pState) == 0)
+				{
+					*pdTotalDistance += Move.dDistDiff;
+					bChanged = true;
+				}
+			}
+		}
+
+		endLocalSearchPass(LS_RELOCATE, iVehicleCount, pState);
+	}
+	while (bChanged && iRet == 0);
+
+	// cleanup
+	pArena->release(iMark);
+
+	return iRet;
+}
+
+// best move of one customer from one tour into the other, in both directions
+void Vrptw::ls_relocate_route_pair(int *piTour1,
+								   int *piTour2,
+								   SEGMENT_t *pSegments,
+								   CROSS_MOVE_t *pMove)
+{
+	int i, j, iDirection, iCustomerCount, iDepot, iMaxCapacity;
+	int iCustomer, iPrev, iNext, iCountFrom, iCountTo;
+	double dRemoveDiff, dDistDiff, dBestDistDiff;
+	int *piFrom, *piTo;
+	SEGMENT_t *pPrefixFrom, *pSuffixFrom, *pPrefixTo, *pSuffixTo;
+	SEGMENT_t Customer, Segment, Tour;
+	double **ppdDistanceMatrix;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+	iMaxCapacity = m_pInstanceData->getCapacity();
+	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+	iDepot = iCustomerCount;
+
+	pMove->dDistDiff = 0.0;
+	dBestDistDiff = -LS_MIN_IMPROVEMENT;
+
+	calcTourSegments(piTour1, pSegments, pSegments + (iCustomerCount+2));
+	calcTourSegments(piTour2, pSegments + (iCustomerCount+2)*2,
+					 pSegments + (iCustomerCount+2)*3);
+
+	for (iDirection=0; iDirection<2; iDirection++)
+	{
+		if (iDirection == 0)
+		{
+			piFrom = piTour1;
+			piTo = piTour2;
+			pPrefixFrom = pSegments;
+		}
+		else
+		{
+			piFrom = piTour2;
+			piTo = piTour1;
+			pPrefixFrom = pSegments + (iCustomerCount+2)*2;
+		}
+
+		pSuffixFrom = pPrefixFrom + (iCustomerCount+2);
+		pPrefixTo = pSegments + (iCustomerCount+2)*2*(1-iDirection);
+		pSuffixTo = pPrefixTo + (iCustomerCount+2);
+
+		iCountFrom = piFrom[0];
+		iCountTo = piTo[0];
+
+		// don't empty a tour
+		if (iCountFrom < 2)
+			continue;
+
+		for (i=1; i<=iCountFrom; i++)
+		{
+			iCustomer = piFrom[i];
+
+			// check capacity
+			if (pPrefixTo[iCountTo].iLoad + pPrefixFrom[i].iLoad
+				- pPrefixFrom[i-1].iLoad > iMaxCapacity)
+			{
+				continue;
+			}
+
+			iPrev = (i == 1) ? iDepot : piFrom[i-1];
+			iNext = (i == iCountFrom) ? iDepot : piFrom[i+1];
+
+			dRemoveDiff = ppdDistanceMatrix[iPrev][iNext]
+				- ppdDistanceMatrix[iPrev][iCustomer]
+				- ppdDistanceMatrix[iCustomer][iNext];
+
+			// tour without the customer
+			concatSegments(&pPrefixFrom[i-1], &pSuffixFrom[i+1], &Tour);
+
+			if (isSegmentFeasible(&Tour) == false)
+				continue;
+
+			initSegment(iCustomer, &Customer);
+
+			for (j=0; j<=iCountTo; j++)
+			{
+				iPrev = (j == 0) ? iDepot : piTo[j];
+				iNext = (j == iCountTo) ? iDepot : piTo[j+1];
+
+				dDistDiff = dRemoveDiff
+					+ ppdDistanceMatrix[iPrev][iCustomer]
+					+ ppdDistanceMatrix[iCustomer][iNext]
+					- ppdDistanceMatrix[iPrev][iNext];
+
+				if (dDistDiff >= dBestDistDiff)
+					continue;
+
+				// tour with the customer
+				concatSegments(&pPrefixTo[j], &Customer, &Segment);
+
+				if (isSegmentFeasible(&Segment) == false)
+					continue;
+
+				concatSegments(&Segment, &pSuffixTo[j+1], &Tour);
+
+				if (isSegmentFeasible(&Tour) == false)
+					continue;
+
+				dBestDistDiff = dDistDiff;
+
+				// as cross exchange with an empty segment
+				if (iDirection == 0)
+				{
+					pMove->iX1 = i-1;
+					pMove->iY1 = i;
+					pMove->iX2 = j;
+					pMove->iY2 = j;
+				}
+				else
+				{
+					pMove->iX1 = j;
+					pMove->iY1 = j;
+					pMove->iX2 = i-1;
+					pMove->iY2 = i;
+				}
+
+				pMove->dDistDiff = dDistDiff;
+			}
+		}
+	}
+}
+
+int Vrptw::ls_or_opt_matrix(int iVehicleCount,
+							double *pdTotalDistance,
+							int **ppiTourMatrix,
+							bool *pbAbort,
+							LS_STATE_t *pState)
+{
+	int iRoute, iCustomerCount, iMark;
+	double dDistDiff;
+	int *piTempTour;
+	SEGMENT_t *pSegments;
+	ScratchArena *pArena;
+
+	// check params
+	if (m_pInstanceData == NULL)
+		return -1;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+
+	// allocate memory
+	pArena = getScratchArena(iVehicleCount, pState);
+	iMark = pArena->getMark();
+
+	piTempTour = (int *)pArena->alloc(sizeof(int) * (iCustomerCount+1));
+	pSegments = (SEGMENT_t *)pArena->alloc(sizeof(SEGMENT_t)
+		* (iCustomerCount+2) * 2);
+
+	if (piTempTour == NULL || pSegments == NULL)
+	{
+		pArena->release(iMark);
+		return -1;
+	}
+
+	for (iRoute=0; iRoute<iVehicleCount; iRoute++)
+	{
+		if (pbAbort != NULL && *pbAbort)
+		{
+			pArena->release(iMark);
+			return -1;
+		}
+
+		if (isRouteDirty(LS_OR_OPT, iRoute, pState) == false)
+			continue;
+
+		ls_or_opt_route(ppiTourMatrix[iRoute], pSegments, piTempTour,
+			&dDistDiff, pState != NULL ? pState->pbDontLook : NULL);
+
+		if (dDistDiff < 0.0)
+		{
+			*pdTotalDistance += dDistDiff;
+
+			if (pState != NULL)
+			{
+				markRouteChanged(iRoute, pState);
+				pState->iMoveCount++;
+			}
+		}
+	}
+
+	// every route is at its local optimum
+	if (pState != NULL)
+	{
+		for (iRoute=0; iRoute<iVehicleCount; iRoute++)
+			pState->pbRouteDirty[LS_OR_OPT][iRoute] = false;
+	}
+
+	// cleanup
+	pArena->release(iMark);
+
+	return 0;
+}
+
+// Moves segments of 1-3 customers to another position of the same tour
+// (best improvement), until no improving move is left. The tour between
+// the old and the new position is extended one customer at a time, so
+// every move is evaluated in O(1).
+//
+void Vrptw::ls_or_opt_route(int *piTour,
+							SEGMENT_t *pSegments,
+							int *piTempTour,
+							double *pdDistDiff,
+							bool *pbDontLook)
+{
+	int i, k, iPos, iLength, iCount, iCustomerCount, iDepot;
+	int iBestPos, iBestInsert, iBestLength;
+	int iFirst, iLast, iPrev, iNext;
+	double dRemoveDiff, dDistDiff, dBestDistDiff;
+	SEGMENT_t *pPrefix, *pSuffix;
+	SEGMENT_t Moved, Node, Part, Segment, Tour;
+	double **ppdDistanceMatrix;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+	iDepot = iCustomerCount;
+
+	pPrefix = pSegments;
+	pSuffix = pSegments + (iCustomerCount+2);
+
+	*pdDistDiff = 0.0;
+
+	iCount = piTour[0];
+
+	while (true)
+	{
+		calcTourSegments(piTour, pPrefix, pSuffix);
+
+		dBestDistDiff = -LS_MIN_IMPROVEMENT;
+		iBestLength = 0;
+
+		for (iLength=1; iLength<=3 && iLength<iCount; iLength++)
+		{
+			// segment piTour[iPos..iPos+iLength-1]
+			for (iPos=1; iPos+iLength-1<=iCount; iPos++)
+			{
+				iFirst = piTour[iPos];
+				iLast = piTour[iPos+iLength-1];
+				iPrev = (iPos == 1) ? iDepot : piTour[iPos-1];
+				iNext = (iPos+iLength-1 == iCount) ? iDepot
+					: piTour[iPos+iLength];
+
+				dRemoveDiff = ppdDistanceMatrix[iPrev][iNext]
+					- ppdDistanceMatrix[iPrev][iFirst]
+					- ppdDistanceMatrix[iLast][iNext];
+
+				initSegment(iFirst, &Moved);
+
+				for (k=iPos+1; k<iPos+iLength; k++)
+				{
+					initSegment(piTour[k], &Node);
+					concatSegments(&Moved, &Node, &Segment);
+					Moved = Segment;
+				}
+
+				// forward: insert after piTour[i], i > segment
+				Part = pPrefix[iPos-1];
+
+				for (i=iPos+iLength; i<=iCount; i++)
+				{
+					initSegment(piTour[i], &Node);
+					concatSegments(&Part, &Node, &Segment);
+					Part = Segment;
+
+					if (isSegmentFeasible(&Part) == false)
+						break; // not feasible, later positions neither
+
+					iPrev = piTour[i];
+					iNext = (i == iCount) ? iDepot : piTour[i+1];
+
+					dDistDiff = dRemoveDiff
+						+ ppdDistanceMatrix[iPrev][iFirst]
+						+ ppdDistanceMatrix[iLast][iNext]
+						- ppdDistanceMatrix[iPrev][iNext];
+
+					if (dDistDiff >= dBestDistDiff)
+						continue;
+
+					concatSegments(&Part, &Moved, &Segment);
+					concatSegments(&Segment, &pSuffix[i+1], &Tour);
+
+					if (isSegmentFeasible(&Tour) == false)
+						continue;
+
+					dBestDistDiff = dDistDiff;
+					iBestPos = iPos;
+					iBestLength = iLength;
+					iBestInsert = i;
+				}
+
+				// backward: insert after piTour[i], i < segment-1
+				Part = pSuffix[iPos+iLength];
+
+				for (i=iPos-2; i>=0; i--)
+				{
+					initSegment(piTour[i+1], &Node);
+					concatSegments(&Node, &Part, &Segment);
+					Part = Segment;
+
+					if (isSegmentFeasible(&Part) == false)
+						break; // not feasible, earlier positions neither
+
+					iPrev = (i == 0) ? iDepot : piTour[i];
+					iNext = piTour[i+1];
+
+					dDistDiff = dRemoveDiff
+						+ ppdDistanceMatrix[iPrev][iFirst]
+						+ ppdDistanceMatrix[iLast][iNext]
+						- ppdDistanceMatrix[iPrev][iNext];
+
+					if (dDistDiff >= dBestDistDiff)
+						continue;
+
+					concatSegments(&Moved, &Part, &Segment);
+					concatSegments(&pPrefix[i], &Segment, &Tour);
+
+					if (isSegmentFeasible(&Tour) == false)
+						continue;
+
+					dBestDistDiff = dDistDiff;
+					iBestPos = iPos;
+					iBestLength = iLength;
+					iBestInsert = i;
+				}
+			}
+		}
+
+		if (iBestLength == 0)
+			break; // local optimum
+
+		// build new tour
+		k = 1;
+
+		if (iBestInsert > iBestPos)
+		{
+			for (i=1; i<iBestPos; i++)
+				piTempTour[k++] = piTour[i];
+
+			for (i=iBestPos+iBestLength; i<=iBestInsert; i++)
+				piTempTour[k++] = piTour[i];
+
+			for (i=iBestPos; i<iBestPos+iBestLength; i++)
+				piTempTour[k++] = piTour[i];
+
+			for (i=iBestInsert+1; i<=iCount; i++)
+				piTempTour[k++] = piTour[i];
+		}
+		else
+		{
+			for (i=1; i<=iBestInsert; i++)
+				piTempTour[k++] = piTour[i];
+
+			for (i=iBestPos; i<iBestPos+iBestLength; i++)
+				piTempTour[k++] = piTour[i];
+
+			for (i=iBestInsert+1; i<iBestPos; i++)
+				piTempTour[k++] = piTour[i];
+
+			for (i=iBestPos+iBestLength; i<=iCount; i++)
+				piTempTour[k++] = piTour[i];
+		}
+
+		piTempTour[0] = iCount;
+
+		// the concatenation rounds differently than the simulation
+		if (checkTour(piTempTour) == false)
+			break;
+
+		IntCopy(piTour, piTempTour, iCount+1);
+		*pdDistDiff += dBestDistDiff;
+
+		if (pbDontLook != NULL)
+		{
+			if (iBestInsert > iBestPos)
+			{
+				clearDontLookBits(piTour, iBestPos-1, pbDontLook);
+				clearDontLookBits(piTour, iBestInsert-iBestLength, pbDontLook);
+				clearDontLookBits(piTour, iBestInsert, pbDontLook);
+			}
+			else
+			{
+				clearDontLookBits(piTour, iBestInsert, pbDontLook);
+				clearDontLookBits(piTour, iBestInsert+iBestLength, pbDontLook);
+				clearDontLookBits(piTour, iBestPos+iBestLength-1, pbDontLook);
+			}
+		}
+	}
+}
+
+int Vrptw::ls_two_opt_star_matrix(int iVehicleCount,
+								  double *pdTotalDistance,
+								  int **ppiTourMatrix,
+								  bool *pbAbort,
+								  LS_STATE_t *pState)
+{
+	bool bChanged;
+	int iRoute1, iRoute2, iCustomerCount, iMark, iRet;
+	int *piTempTour1, *piTempTour2;
+	SEGMENT_t *pSegments;
+	CROSS_MOVE_t Move;
+	ScratchArena *pArena;
+
+	// check params
+	if (m_pInstanceData == NULL)
+		return -1;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+
+	// allocate memory
+	pArena = getScratchArena(iVehicleCount, pState);
+	iMark = pArena->getMark();
+
+	piTempTour1 = (int *)pArena->alloc(sizeof(int) * (iCustomerCount+1));
+	piTempTour2 = (int *)pArena->alloc(sizeof(int) * (iCustomerCount+1));
+	pSegments = (SEGMENT_t *)pArena->alloc(sizeof(SEGMENT_t)
+		* (iCustomerCount+2) * 4);
+
+	if (piTempTour1 == NULL || piTempTour2 == NULL || pSegments == NULL)
+	{
+		pArena->release(iMark);
+		return -1;
+	}
+
+	iRet = 0;
+
+	do
+	{
+		bChanged = false;
+
+		beginLocalSearchPass(iVehicleCount, pState);
+
+		for (iRoute1=0; iRoute1<iVehicleCount-1 && iRet == 0; iRoute1++)
+		{
+			for (iRoute2=iRoute1+1; iRoute2<iVehicleCount; iRoute2++)
+			{
+				if (pbAbort != NULL && *pbAbort)
+				{
+					iRet = -1;
+					break;
+				}
+
+				// nothing changed since the last examination?
+				if (isRouteDirty(LS_TWO_OPT_STAR, iRoute1, pState) == false
+					&& isRouteDirty(LS_TWO_OPT_STAR, iRoute2, pState) == false)
+				{
+					continue;
+				}
+
+				ls_two_opt_star_route_pair(ppiTourMatrix[iRoute1],
+					ppiTourMatrix[iRoute2], pSegments, &Move);
+
+				if (Move.dDistDiff < 0.0
+					&& ls_apply_route_pair_move(iRoute1, iRoute2, &Move,
+						ppiTourMatrix, piTempTour1, piTempTour2, pState) == 0)
+				{
+					*pdTotalDistance += Move.dDistDiff;
+					bChanged = true;
+				}
+			}
+		}
+
+		endLocalSearchPass(LS_TWO_OPT_STAR, iVehicleCount, pState);
+	}
+	while (bChanged && iRet == 0);
+
+	// cleanup
+	pArena->release(iMark);
+
+	return iRet;
+}
+
+// best exchange of the tails of two tours
+void Vrptw::ls_two_opt_star_route_pair(int *piTour1,
+									   int *piTour2,
+									   SEGMENT_t *pSegments,
+									   CROSS_MOVE_t *pMove)
+{
+	int i, j, iCount1, iCount2, iCustomerCount, iDepot;
+	int iCustomer1_0, iCustomer1_1, iCustomer2_0, iCustomer2_1;
+	double dDistDiff, dBestDistDiff;
+	SEGMENT_t *pPrefix1, *pSuffix1, *pPrefix2, *pSuffix2;
+	SEGMENT_t Tour;
+	double **ppdDistanceMatrix;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+	iDepot = iCustomerCount;
+
+	pMove->dDistDiff = 0.0;
+	dBestDistDiff = -LS_MIN_IMPROVEMENT;
+
+	iCount1 = piTour1[0];
+	iCount2 = piTour2[0];
+
+	pPrefix1 = pSegments;
+	pSuffix1 = pPrefix1 + (iCustomerCount+2);
+	pPrefix2 = pSuffix1 + (iCustomerCount+2);
+	pSuffix2 = pPrefix2 + (iCustomerCount+2);
+
+	calcTourSegments(piTour1, pPrefix1, pSuffix1);
+	calcTourSegments(piTour2, pPrefix2, pSuffix2);
+
+	// new tour 1 = tour1[1..i] + tour2[j+1..], new tour 2 = tour2[1..j] + tour1[i+1..]
+	for (i=0; i<=iCount1; i++)
+	{
+		iCustomer1_0 = (i == 0) ? iDepot : piTour1[i];
+		iCustomer1_1 = (i == iCount1) ? iDepot : piTour1[i+1];
+
+		for (j=0; j<=iCount2; j++)
+		{
+			// same tours or an empty tour?
+			if ((i == 0 && j == 0)
+				|| (i == iCount1 && j == iCount2)
+				|| i + iCount2 - j == 0
+				|| j + iCount1 - i == 0)
+			{
+				continue;
+			}
+
+			iCustomer2_0 = (j == 0) ? iDepot : piTour2[j];
+			iCustomer2_1 = (j == iCount2) ? iDepot : piTour2[j+1];
+
+			dDistDiff = ppdDistanceMatrix[iCustomer1_0][iCustomer2_1]
+				+ ppdDistanceMatrix[iCustomer2_0][iCustomer1_1]
+				- ppdDistanceMatrix[iCustomer1_0][iCustomer1_1]
+				- ppdDistanceMatrix[iCustomer2_0][iCustomer2_1];
+
+			if (dDistDiff >= dBestDistDiff)
+				continue;
+
+			concatSegments(&pPrefix1[i], &pSuffix2[j+1], &Tour);
+
+			if (isSegmentFeasible(&Tour) == false)
+				continue;
+
+			concatSegments(&pPrefix2[j], &pSuffix1[i+1], &Tour);
+
+			if (isSegmentFeasible(&Tour) == false)
+				continue;
+
+			// as cross exchange of both tails
+			dBestDistDiff = dDistDiff;
+			pMove->iX1 = i;
+			pMove->iY1 = iCount1;
+			pMove->iX2 = j;
+			pMove->iY2 = iCount2;
+			pMove->dDistDiff = dDistDiff;
+		}
+	}
+}
+
+// builds both tours of a move, checks them and copies them back
+int Vrptw::ls_apply_route_pair_move(int iRoute1,
+									int iRoute2,
+									CROSS_MOVE_t *pMove,
+									int **ppiTourMatrix,
+									int *piTempTour1,
+									int *piTempTour2,
+									LS_STATE_t *pState)
+{
+	ls_cross_exchange_tour(pMove->iX1, pMove->iX2, pMove->iY1, pMove->iY2,
+		ppiTourMatrix[iRoute1][0], ppiTourMatrix[iRoute2][0],
+		ppiTourMatrix[iRoute1], ppiTourMatrix[iRoute2],
+		piTempTour1, piTempTour2);
+
+	// the concatenation rounds differently than the simulation
+	if (checkTour(piTempTour1) == false || checkTour(piTempTour2) == false)
+		return -1;
+
+	IntCopy(ppiTourMatrix[iRoute1], piTempTour1, piTempTour1[0]+1);
+	IntCopy(ppiTourMatrix[iRoute2], piTempTour2, piTempTour2[0]+1);
+
+	if (pState != NULL)
+		applyCrossMoveToState(iRoute1, iRoute2, pMove, ppiTourMatrix, pState);
+
+	return 0;
+}
+
+void Vrptw::initSegment(int iNode,
+						SEGMENT_t *pSegment)
+{
+	if (iNode == m_pInstanceData->getCustomerCount()) // depot
+	{
+		pSegment->dDuration = 0.0;
+		pSegment->dEarliest = 0.0;
+		pSegment->dLatest = m_pInstanceData->getDepotDueDate();
+		pSegment->iLoad = 0;
+	}
+	else
+	{
+		pSegment->dDuration = m_pInstanceData->getCustomerServiceTime()[iNode];
+		pSegment->dEarliest = m_pInstanceData->getCustomerReadyTime()[iNode];
+		pSegment->dLatest = m_pInstanceData->getCustomerDueDate()[iNode];
+		pSegment->iLoad = m_pInstanceData->getCustomerDemand()[iNode];
+	}
+
+	pSegment->dTimeWarp = 0.0;
+	pSegment->iFirst = iNode;
+	pSegment->iLast = iNode;
+}
+
+// pResult may not be one of the input segments
+void Vrptw::concatSegments(const SEGMENT_t *pSegment1,
+						   const SEGMENT_t *pSegment2,
+						   SEGMENT_t *pResult)
+{
+	double dTravel, dDelta, dWaiting, dTimeWarp;
+
+	dTravel = m_pInstanceData->getDistanceMatrix()
+		[pSegment1->iLast][pSegment2->iFirst];
+
+	dDelta = pSegment1->dDuration - pSegment1->dTimeWarp + dTravel;
+	dWaiting = __max(pSegment2->dEarliest - dDelta - pSegment1->dLatest, 0.0);
+	dTimeWarp = __max(pSegment1->dEarliest + dDelta - pSegment2->dLatest, 0.0);
+
+	pResult->dDuration = pSegment1->dDuration + pSegment2->dDuration
+		+ dTravel + dWaiting;
+	pResult->dTimeWarp = pSegment1->dTimeWarp + pSegment2->dTimeWarp
+		+ dTimeWarp;
+	pResult->dEarliest = __max(pSegment2->dEarliest - dDelta,
+		pSegment1->dEarliest);
+	pResult->dEarliest -= dWaiting;
+	pResult->dLatest = __min(pSegment2->dLatest - dDelta, pSegment1->dLatest);
+	pResult->dLatest += dTimeWarp;
+	pResult->iLoad = pSegment1->iLoad + pSegment2->iLoad;
+	pResult->iFirst = pSegment1->iFirst;
+	pResult->iLast = pSegment2->iLast;
+}
+
+bool Vrptw::isSegmentFeasible(const SEGMENT_t *pSegment)
+{
+	return pSegment->dTimeWarp <= 0.0
+		&& pSegment->iLoad <= m_pInstanceData->getCapacity();
+}
+
+// pPrefix[i] = depot..piTour[i] for i = 0..count,
+// pSuffix[i] = piTour[i]..depot for i = 1..count+1
+//
+void Vrptw::calcTourSegments(int *piTour,
+							 SEGMENT_t *pPrefix,
+							 SEGMENT_t *pSuffix)
+{
+	int i, iCount, iDepot;
+	SEGMENT_t Node;
+
+	iCount = piTour[0];
+	iDepot = m_pInstanceData->getCustomerCount();
+
+	initSegment(iDepot, &pPrefix[0]);
+
+	for (i=1; i<=iCount; i++)
+	{
+		initSegment(piTour[i], &Node);
+		concatSegments(&pPrefix[i-1], &Node, &pPrefix[i]);
+	}
+
+	initSegment(iDepot, &pSuffix[iCount+1]);
+
+	for (i=iCount; i>=1; i--)
+	{
+		initSegment(piTour[i], &Node);
+		concatSegments(&Node, &pSuffix[i+1], &pSuffix[i]);
+	}
+}
+
+// capacity and time windows of one tour
+bool Vrptw::checkTour(int *piTour)
+{
+	int i, iCapacity, iCustomerCount, iLastCustomer, iNextCustomer;
+	double dTime;
+	double **ppdDistanceMatrix;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+
+	dTime = 0.0;
+	iCapacity = 0;
+	iLastCustomer = iCustomerCount; // depot
+
+	for (i=1; i<=piTour[0]; i++)
+	{
+		iNextCustomer = piTour[i];
+
+		iCapacity += m_pInstanceData->getCustomerDemand()[iNextCustomer];
+		dTime += ppdDistanceMatrix[iLastCustomer][iNextCustomer];
+
+		if (dTime < m_pInstanceData->getCustomerReadyTime()[iNextCustomer])
+			dTime = m_pInstanceData->getCustomerReadyTime()[iNextCustomer];
+		else if (dTime > m_pInstanceData->getCustomerDueDate()[iNextCustomer])
+			return false;
+
+		dTime += m_pInstanceData->getCustomerServiceTime()[iNextCustomer];
+
+		iLastCustomer = iNextCustomer;
+	}
+
+	dTime += ppdDistanceMatrix[iLastCustomer][iCustomerCount];
+
+	return dTime <= m_pInstanceData->getDepotDueDate()
+		&& iCapacity <= m_pInstanceData->getCapacity();
+}
+
+// Variable neighborhood descent: the operators are applied in the order of
+// the list, after an improvement it restarts with the first one. An
+// operator which has used up its cpu budget is skipped for the rest of the
+// call; the budget is only checked between operator calls, so a single
+// call may overrun it. In adaptive mode the list is sorted by the measured
+// improvement per microsecond first. Both depend on measured times and are
+// ignored in reproducible mode, the times are only measured if one of them
+// is used.
+//
+int Vrptw::ls_vnd_matrix(int iVehicleCount,
+						 double *pdTotalDistance,
+						 int **ppiTourMatrix,
+						 bool *pbAbort,
+						 LS_STATE_t *pState)
+{
+	bool bTimed;
+	int i, iOperator, iOperatorCount;
+	int piOperators[LS_OPERATOR_COUNT];
+	long long llStart, llMicroseconds;
+	long long pllUsed[LS_OPERATOR_COUNT];
+	double dDistance;
+
+	// check params
+	if (m_pInstanceData == NULL)
+		return -1;
+
+	pthread_mutex_lock(&m_mutexVndStatistics);
+
+	if (m_bVndAdaptive && m_bReproducible == false)
+		sortVndOperators();
+
+	iOperatorCount = m_iVndOperatorCount;
+
+	for (i=0; i<iOperatorCount; i++)
+		piOperators[i] = m_piVndOperators[i];
+
+	pthread_mutex_unlock(&m_mutexVndStatistics);
+
+	bTimed = m_bVndAdaptive;
+
+	for (i=0; i<LS_OPERATOR_COUNT; i++)
+	{
+		pllUsed[i] = 0;
+
+		if (m_piVndBudget[i] > 0)
+			bTimed = true;
+	}
+
+	if (m_bReproducible)
+		bTimed = false;
+
+	i = 0;
+
+	while (i < iOperatorCount)
+	{
+		if (pbAbort != NULL && *pbAbort)
+			return -1;
+
+		iOperator = piOperators[i];
+
+		// budget used up?
+		if (m_piVndBudget[iOperator] > 0 && m_bReproducible == false
+			&& pllUsed[iOperator] >= m_piVndBudget[iOperator])
+		{
+			i++;
+			continue;
+		}
+
+		dDistance = *pdTotalDistance;
+		llStart = bTimed ? ThreadCpuMicroseconds() : 0;
+
+		if (ls_run_operator(iOperator, iVehicleCount, pdTotalDistance,
+							ppiTourMatrix, pbAbort, pState) != 0)
+		{
+			return -1;
+		}
+
+		llMicroseconds = bTimed ? ThreadCpuMicroseconds() - llStart : 0;
+		pllUsed[iOperator] += llMicroseconds;
+
+		pthread_mutex_lock(&m_mutexVndStatistics);
+		m_pdVndGain[iOperator] += dDistance - *pdTotalDistance;
+		m_pllVndMicroseconds[iOperator] += llMicroseconds;
+		pthread_mutex_unlock(&m_mutexVndStatistics);
+
+		// improvement: restart with the first operator
+		if (*pdTotalDistance < dDistance - LS_MIN_IMPROVEMENT)
+			i = 0;
+		else
+			i++;
+	}
+
+	return 0;
+}
+
+int Vrptw::ls_vnd(int iVehicleCount,
+				  double *pdTotalDistance,
+				  int *piTours,
+				  bool *pbAbort)
+{
+	bool bSetSolution;
+	int iRet, iCustomerCount;
+	double dTotalDistance;
+	int **ppiTourMatrix;
+	LS_STATE_t State;
+
+	// check params
+	if (m_pInstanceData == NULL)
+		return -1;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+
+	// use stored solution?
+	if (iVehicleCount == 0 || pdTotalDistance == NULL || piTours == NULL)
+	{
+		pdTotalDistance = &dTotalDistance;
+		piTours = m_pInstanceData->getSolutionTours(&iVehicleCount,
+			pdTotalDistance);
+
+		if (piTours == NULL)
+			return -1;
+
+		bSetSolution = true;
+	}
+	else
+		bSetSolution = false;
+
+	if (prepareRouteCache() != 0)
+		return -1;
+
+	// allocate memory
+	if (prepareScratchArena(ScratchArena::getAllocSize(sizeof(int)
+			* iVehicleCount * (iCustomerCount+1) + sizeof(int *) * iVehicleCount)
+		+ getLocalSearchScratchSize(iVehicleCount)) != 0)
+	{
+		return -1;
+	}
+
+	ppiTourMatrix = m_pScratchArena->allocIntMatrix(iVehicleCount,
+													iCustomerCount+1);
+	
+	if (ppiTourMatrix == NULL)
+		return -1;
+
+	if (createLocalSearchState(iVehicleCount, &State) != 0)
+	{
+		m_pScratchArena->release(0);
+		return -1;
+	}
+
+	State.pArena = m_pScratchArena;
+
+	// copy tours to tour matrix
+	convertToTourMatrix(iVehicleCount, piTours, ppiTourMatrix);
+
+	iRet = ls_vnd_matrix(iVehicleCount, pdTotalDistance, ppiTourMatrix,
+						 pbAbort, &State);
+
+	if (iRet == 0)
+	{
+		// copy tour matrix to tours
+		convertFromTourMatrix(iVehicleCount, piTours, ppiTourMatrix);
+
+		if (bSetSolution)
+		{
+			m_pInstanceData->setSolutionVehicleCount(iVehicleCount);
+			m_pInstanceData->setSolutionDistance(*pdTotalDistance);
+		}
+	}
+
+	// free memory
+	freeLocalSearchState(&State);
+	m_pScratchArena->release(0);
+
+	return iRet;
+}
+
+int Vrptw::ls_run_operator(int iOperator,
+						   int iVehicleCount,
+						   double *pdTotalDistance,
+						   int **ppiTourMatrix,
+						   bool *pbAbort,
+						   LS_STATE_t *pState)
+{
+	switch (iOperator)
+	{
+	case LS_INTRA_EXCHANGE:
+		if (m_iLocalSearchThreads > 1
+			&& (pState == NULL || pState->bSingleThread == false))
+			return ls_intra_exchange_matrix_parallel(iVehicleCount,
+				pdTotalDistance, ppiTourMatrix, pbAbort, pState);
+
+		return ls_intra_exchange_matrix(iVehicleCount, pdTotalDistance,
+			ppiTourMatrix, pbAbort, pState);
+
+	case LS_CROSS_EXCHANGE:
+		if (m_iLocalSearchThreads > 1
+			&& (pState == NULL || pState->bSingleThread == false))
+			return ls_cross_exchange_matrix_parallel(iVehicleCount,
+				pdTotalDistance, ppiTourMatrix, pbAbort, pState);
+
+		return ls_cross_exchange_matrix(iVehicleCount, pdTotalDistance,
+			ppiTourMatrix, pbAbort, pState);
+
+	case LS_RELOCATE:
+		return ls_relocate_matrix(iVehicleCount, pdTotalDistance,
+			ppiTourMatrix, pbAbort, pState);
+
+	case LS_OR_OPT:
+		return ls_or_opt_matrix(iVehicleCount, pdTotalDistance,
+			ppiTourMatrix, pbAbort, pState);
+
+	case LS_TWO_OPT_STAR:
+		return ls_two_opt_star_matrix(iVehicleCount, pdTotalDistance,
+			ppiTourMatrix, pbAbort, pState);
+	}
+
+	return -1;
+}
+
+// best improvement per microsecond first, operators without measurements
+// keep their position relative to each other
+//
+void Vrptw::sortVndOperators()
+{
+	int i, j, iOperator;
+	double dRate;
+	double pdRate[LS_OPERATOR_COUNT];
+
+	for (i=0; i<LS_OPERATOR_COUNT; i++)
+	{
+		if (m_pllVndMicroseconds[i] > 0)
+			pdRate[i] = m_pdVndGain[i] / m_pllVndMicroseconds[i];
+		else
+			pdRate[i] = m_pdVndGain[i];
+	}
+
+	// insertion sort, stable
+	for (i=1; i<m_iVndOperatorCount; i++)
+	{
+		iOperator = m_piVndOperators[i];
+		dRate = pdRate[iOperator];
+
+		for (j=i; j>0 && pdRate[m_piVndOperators[j-1]] < dRate; j--)
+			m_piVndOperators[j] = m_piVndOperators[j-1];
+
+		m_piVndOperators[j] = iOperator;
+	}
+}
+
+void Vrptw::setParamVndOperators(int iCount,
+								 const int *piOperators)
+{
+	int i;
+
+	// check params
+	if (iCount < 1 || iCount > LS_OPERATOR_COUNT || piOperators == NULL)
+		return;
+
+	for (i=0; i<iCount; i++)
+	{
+		if (piOperators[i] < 0 || piOperators[i] >= LS_OPERATOR_COUNT)
+			return;
+	}
+
+	for (i=0; i<iCount; i++)
+		m_piVndOperators[i] = piOperators[i];
+
+	m_iVndOperatorCount = iCount;
+}
+
+int Vrptw::getParamVndOperators(int *piOperators)
+{
+	int i;
+
+	for (i=0; i<m_iVndOperatorCount; i++)
+		piOperators[i] = m_piVndOperators[i];
+
+	return m_iVndOperatorCount;
+}
+
+// improvement and cpu time of an operator summed over all vnd calls
+void Vrptw::getVndStatistics(int iOperator,
+							 double *pdGain,
+							 long long *pllMicroseconds)
+{
+	if (iOperator < 0 || iOperator >= LS_OPERATOR_COUNT)
+		return;
+
+	*pdGain = m_pdVndGain[iOperator];
+	*pllMicroseconds = m_pllVndMicroseconds[iOperator];
+}
+
+// checks capacity, time windows and that every customer is served exactly
+// once, and recalculates the total distance
+//
+bool Vrptw::checkTourMatrix(int iVehicleCount,
+							int **ppiTourMatrix,
+							double *pdTotalDistance,
+							ScratchArena *pArena)
+{
+	bool bFeasible;
+	int i, iVehicle, iCustomerCount, iCapacity, iMaxCapacity, iDepotDueDate;
+	int iMark;
+	int iLastCustomer, iNextCustomer;
+	double dTime, dTotalDistance;
+	int *piCustomerDemand, *piCustomerReadyTime, *piCustomerDueDate;
+	int *piCustomerServiceTime;
+	bool *pbCustomerVisited;
+	double **ppdDistanceMatrix;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+	iMaxCapacity = m_pInstanceData->getCapacity();
+	iDepotDueDate = m_pInstanceData->getDepotDueDate();
+
+	piCustomerDemand = m_pInstanceData->getCustomerDemand();
+	piCustomerReadyTime = m_pInstanceData->getCustomerReadyTime();
+	piCustomerDueDate = m_pInstanceData->getCustomerDueDate();
+	piCustomerServiceTime = m_pInstanceData->getCustomerServiceTime();
+	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+
+	// allocate memory
+	iMark = pArena->getMark();
+	pbCustomerVisited = (bool*)pArena->alloc(sizeof(bool)*iCustomerCount);
+
+	if (pbCustomerVisited == NULL)
+		return false;
+
+	for (i=0; i<iCustomerCount; i++)
+		pbCustomerVisited[i] = false;
+
+	bFeasible = true;
+	dTotalDistance = 0.0;
+
+	for (iVehicle=0; iVehicle<iVehicleCount && bFeasible; iVehicle++)
+	{
+		dTime = 0.0;
+		iCapacity = 0;
+		iLastCustomer = iCustomerCount; // depot
+
+		for (i=1; i<=ppiTourMatrix[iVehicle][0]; i++)
+		{
+			iNextCustomer = ppiTourMatrix[iVehicle][i];
+
+			// already visited?
+			if (iNextCustomer < 0
+				|| iNextCustomer >= iCustomerCount
+				|| pbCustomerVisited[iNextCustomer])
+			{
+				bFeasible = false;
+				break;
+			}
+
+			pbCustomerVisited[iNextCustomer] = true;
+
+			// check capacity
+			iCapacity += piCustomerDemand[iNextCustomer];
+
+			if (iCapacity > iMaxCapacity)
+			{
+				bFeasible = false;
+				break;
+			}
+
+			// check time window
+			dTime += ppdDistanceMatrix[iLastCustomer][iNextCustomer];
+			dTotalDistance += ppdDistanceMatrix[iLastCustomer][iNextCustomer];
+
+			if (dTime < piCustomerReadyTime[iNextCustomer])
+				dTime = piCustomerReadyTime[iNextCustomer];
+			else if (dTime > piCustomerDueDate[iNextCustomer])
+			{
+				bFeasible = false;
+				break;
+			}
+
+			dTime += piCustomerServiceTime[iNextCustomer];
+
+			iLastCustomer = iNextCustomer;
+		}
+
+		dTime += ppdDistanceMatrix[iLastCustomer][iCustomerCount];
+		dTotalDistance += ppdDistanceMatrix[iLastCustomer][iCustomerCount];
+
+		if (dTime > iDepotDueDate)
+			bFeasible = false;
+	}
+
+	// all customers visited?
+	for (i=0; i<iCustomerCount && bFeasible; i++)
+	{
+		if (pbCustomerVisited[i] == false)
+			bFeasible = false;
+	}
+
+	// cleanup
+	pArena->release(iMark);
+
+	if (bFeasible)
+		*pdTotalDistance = dTotalDistance;
+
+	return bFeasible;
+}
+
+// schedules of both routes and the buffers of the distance filter
+int Vrptw::getRoutePairScheduleSize()
+{
+	return (m_pInstanceData->getCustomerCount()+2)
+		* (sizeof(double)*7 + sizeof(int)*4);
+}
+
+// temp tour and arcs of a route, a multiple of the arena alignment
+int Vrptw::getIntraRouteScratchSize()
+{
+	return ScratchArena::getAllocSize(sizeof(int)
+			* (m_pInstanceData->getCustomerCount()+1))
+		+ ScratchArena::getAllocSize(sizeof(double)
+			* (m_pInstanceData->getCustomerCount()+2));
+}
+
+// upper bound of the buffers which one operator call takes from the arena
+int Vrptw::getLocalSearchScratchSize(int iVehicleCount)
+{
+	int iCustomerCount, iPairCount, iSize, iMaxSize;
+
+	iCustomerCount = m_pInstanceData->getCustomerCount();
+	iPairCount = iVehicleCount * (iVehicleCount-1) / 2;
+
+	// cross exchange
+	iMaxSize = ScratchArena::getAllocSize(sizeof(int)*(iCustomerCount+1)) * 2
+		+ ScratchArena::getAllocSize(getRoutePairScheduleSize())
+		+ ScratchArena::getAllocSize(sizeof(ROUTE_SUMMARY_t)*iVehicleCount);
+
+	// parallel cross exchange
+	iSize = ScratchArena::getAllocSize(getRoutePairScheduleSize()
+			* m_iLocalSearchThreads)
+		+ ScratchArena::getAllocSize(sizeof(CROSS_MOVE_t)*iPairCount) * 2
+		+ ScratchArena::getAllocSize(sizeof(int)*iPairCount*2)
+		+ ScratchArena::getAllocSize(sizeof(int)*iPairCount)
+		+ ScratchArena::getAllocSize(sizeof(int)*(iCustomerCount+1)) * 2
+		+ ScratchArena::getAllocSize(sizeof(bool)*iVehicleCount)
+		+ ScratchArena::getAllocSize(sizeof(bool)*iCustomerCount)
+		+ ScratchArena::getAllocSize(sizeof(ROUTE_SUMMARY_t)*iVehicleCount);
+
+	if (iSize > iMaxSize)
+		iMaxSize = iSize;
+
+	// relocate, or-opt and 2-opt*
+	iSize = ScratchArena::getAllocSize(sizeof(int)*(iCustomerCount+1)) * 2
+		+ ScratchArena::getAllocSize(sizeof(SEGMENT_t)*(iCustomerCount+2)*4);
+
+	if (iSize > iMaxSize)
+		iMaxSize = iSize;
+
+	// parallel intra exchange
+	iSize = ScratchArena::getAllocSize(sizeof(double)*iVehicleCount)
+		+ ScratchArena::getAllocSize(getIntraRouteScratchSize()
+			* m_iLocalSearchThreads)
+		+ ScratchArena::getAllocSize(sizeof(bool)*iCustomerCount);
+
+	if (iSize > iMaxSize)
+		iMaxSize = iSize;
+
+	return iMaxSize;
+}
+
+// own arena with at least iSize bytes, must not be in use
+int Vrptw::prepareScratchArena(int iSize)
+{
+	if (m_pScratchArena == NULL)
+		m_pScratchArena = new ScratchArena();
+
+	return m_pScratchArena->create(iSize);
+}
+
+ScratchArena *Vrptw::getScratchArena(int iVehicleCount,
+									 LS_STATE_t *pState)
+{
+	if (pState != NULL && pState->pArena != NULL)
+		return pState->pArena;
+
+	// called directly, not by a wrapper?
+	if (m_pScratchArena == NULL || m_pScratchArena->getMark() == 0)
+		prepareScratchArena(getLocalSearchScratchSize(iVehicleCount));
+
+	return m_pScratchArena;
+}
+
+int Vrptw::startLocalSearchPool()
+{
+	if (m_pLocalSearchPool == NULL)
+		m_pLocalSearchPool = new WorkerPool();
+
+	if (m_pLocalSearchPool->getThreadCount() == m_iLocalSearchThreads)
+		return 0;
+
+	return m_pLocalSearchPool->start(m_iLocalSearchThreads);
+}
+
+// a pool must only run one batch at a time, searches which run at the
+// same time need their own pools
+WorkerPool *Vrptw::getLocalSearchPool(LS_STATE_t *pState)
+{
+	if (pState != NULL && pState->pPool != NULL)
+		return pState->pPool;
+
+	if (startLocalSearchPool() != 0)
+		return NULL;
+
+	return m_pLocalSearchPool;
+}
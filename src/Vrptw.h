@@ -34,9 +34,24 @@
 #endif // _MSC_VER > 1000
 
 
+///// includes /////
+
+#include <stdlib.h>
+#include "pthread.h"
+
+
+///// defines /////
+
+// max. number of swaps kept by the best-first intra exchange
+#define LS_INTRA_MAX_CANDIDATES 32
+
+
 //// classes /////
 
 class InstanceData;
+class WorkerPool;
+class ScratchArena;
+class RouteCache;
 
 
 class Vrptw  
@@ -79,6 +94,40 @@ public:
 	}
 	INSTANCE_t;
 
+	// local search operators
+	enum
+	{
+		LS_INTRA_EXCHANGE = 0,
+		LS_CROSS_EXCHANGE,
+		LS_RELOCATE,
+		LS_OR_OPT,
+		LS_TWO_OPT_STAR,
+		LS_OPERATOR_COUNT
+	};
+
+	// move orders of the intra exchange
+	enum
+	{
+		LS_INTRA_FIRST_IMPROVEMENT = 0,	// first swap in (i, j) order
+		LS_INTRA_BEST_FIRST,			// best feasible swap
+		LS_INTRA_BEST_FIRST_MULTI		// best feasible swaps without common arcs
+	};
+
+	// state of the local search which is kept between the operators
+	typedef struct
+	{
+		// route changed since the operator reached its local optimum
+		bool *pbRouteDirty[LS_OPERATOR_COUNT];
+		bool *pbRouteChanged;	// routes changed in the current pass
+		bool *pbDontLook;		// customer without an improving intra exchange
+		int iMoveCount;			// applied moves
+		ScratchArena *pArena;	// buffers of the operators, NULL = own arena
+		bool bSingleThread;		// no local search threads, several searches
+								// run at the same time
+		WorkerPool *pPool;		// started by the caller, NULL = own pool
+	}
+	LS_STATE_t;
+
 public:
 	Vrptw();
 
@@ -88,6 +137,68 @@ public:
 
 	void applyInstanceData(InstanceData *pInstanceData);
 
+	void setParamCrossMaxSegmentLength(int iLength)
+		{ if (iLength >= 0) m_iCrossMaxSegmentLength = iLength; };
+
+	int getParamCrossMaxSegmentLength() { return m_iCrossMaxSegmentLength; };
+
+	void setParamIntraMoveOrder(int iOrder)
+		{ if (iOrder >= LS_INTRA_FIRST_IMPROVEMENT
+			  && iOrder <= LS_INTRA_BEST_FIRST_MULTI) m_iIntraMoveOrder = iOrder; };
+
+	int getParamIntraMoveOrder() { return m_iIntraMoveOrder; };
+
+	// swaps which are checked for feasibility per best-first pass
+	void setParamIntraCandidates(int iCount)
+		{ if (iCount >= 1 && iCount <= LS_INTRA_MAX_CANDIDATES)
+			m_iIntraCandidates = iCount; };
+
+	int getParamIntraCandidates() { return m_iIntraCandidates; };
+
+	// max. distance of the bounding boxes of two routes which are examined
+	// by the cross exchange (0.0 = unbounded)
+	void setParamCrossMaxRouteDistance(double dDistance)
+		{ if (dDistance >= 0.0) m_dCrossMaxRouteDistance = dDistance; };
+
+	double getParamCrossMaxRouteDistance() { return m_dCrossMaxRouteDistance; };
+
+	void setParamLocalSearchThreads(int iThreads)
+		{ if (iThreads >= 1) m_iLocalSearchThreads = iThreads; };
+
+	int getParamLocalSearchThreads() { return m_iLocalSearchThreads; };
+
+	void setParamVndOperators(int iCount,
+							  const int *piOperators);
+
+	int getParamVndOperators(int *piOperators);
+
+	// cpu budget of an operator per vnd call in microseconds, 0 = unbounded
+	void setParamVndBudget(int iOperator, int iMicroseconds)
+		{ if (iOperator >= 0 && iOperator < LS_OPERATOR_COUNT
+			  && iMicroseconds >= 0) m_piVndBudget[iOperator] = iMicroseconds; };
+
+	int getParamVndBudget(int iOperator)
+		{ return (iOperator >= 0 && iOperator < LS_OPERATOR_COUNT)
+			? m_piVndBudget[iOperator] : 0; };
+
+	void setParamVndAdaptive(bool bAdaptive) { m_bVndAdaptive = bAdaptive; };
+
+	bool getParamVndAdaptive() { return m_bVndAdaptive; };
+
+	// entries of the cache of intra exchange results, 0 = no cache
+	void setParamRouteCacheSize(int iEntries)
+		{ if (iEntries >= 0) m_iRouteCacheSize = iEntries; };
+
+	int getParamRouteCacheSize() { return m_iRouteCacheSize; };
+
+	void getRouteCacheStatistics(long long *pllLookups,
+								 long long *pllHits);
+
+	// the times are only measured with a budget or in adaptive mode
+	void getVndStatistics(int iOperator,
+						  double *pdGain,
+						  long long *pllMicroseconds);
+
 	int nn_solomon1987(double dW1,
 					   double dW2,
 					   double dW3);
@@ -97,6 +208,16 @@ public:
 	int nn_ellabib2002(double dW1,
 					   double dW2);
 
+	int createLocalSearchState(int iVehicleCount,
+							   LS_STATE_t *pState);
+
+	void freeLocalSearchState(LS_STATE_t *pState);
+
+	void resetLocalSearchState(int iVehicleCount,
+							   LS_STATE_t *pState);
+
+	int getLocalSearchScratchSize(int iVehicleCount);
+
 	int ls_cross_exchange(int iVehicleCount,
 						  double *pdTotalDistance,
 						  int *piTours,
@@ -105,7 +226,14 @@ public:
 	int ls_cross_exchange_matrix(int iVehicleCount,
 								 double *pdTotalDistance, 
 								 int **ppiTourMatrix,
-								 bool *pbAbort);
+								 bool *pbAbort,
+								 LS_STATE_t *pState=NULL);
+
+	int ls_cross_exchange_matrix_parallel(int iVehicleCount,
+										  double *pdTotalDistance,
+										  int **ppiTourMatrix,
+										  bool *pbAbort,
+										  LS_STATE_t *pState=NULL);
 
 	int ls_intra_exchange(int iVehicleCount,
 						  double *pdTotalDistance,
@@ -115,11 +243,153 @@ public:
 	int ls_intra_exchange_matrix(int iVehicleCount,
 								 double *pdTotalDistance,
 								 int **ppiTourMatrix,
-								 bool *pbAbort);
+								 bool *pbAbort,
+								 LS_STATE_t *pState=NULL);
+
+	int ls_intra_exchange_matrix_parallel(int iVehicleCount,
+										  double *pdTotalDistance,
+										  int **ppiTourMatrix,
+										  bool *pbAbort,
+										  LS_STATE_t *pState=NULL);
+
+	int ls_vnd(int iVehicleCount,
+			   double *pdTotalDistance,
+			   int *piTours,
+			   bool *pbAbort);
+
+	int ls_vnd_matrix(int iVehicleCount,
+					  double *pdTotalDistance,
+					  int **ppiTourMatrix,
+					  bool *pbAbort,
+					  LS_STATE_t *pState=NULL);
+
+	int ls_relocate_matrix(int iVehicleCount,
+						   double *pdTotalDistance,
+						   int **ppiTourMatrix,
+						   bool *pbAbort,
+						   LS_STATE_t *pState=NULL);
+
+	int ls_or_opt_matrix(int iVehicleCount,
+						 double *pdTotalDistance,
+						 int **ppiTourMatrix,
+						 bool *pbAbort,
+						 LS_STATE_t *pState=NULL);
+
+	int ls_two_opt_star_matrix(int iVehicleCount,
+							   double *pdTotalDistance,
+							   int **ppiTourMatrix,
+							   bool *pbAbort,
+							   LS_STATE_t *pState=NULL);
 
 protected:
+	typedef struct
+	{
+		int iRoute1;
+		int iRoute2;
+		int iX1;
+		int iX2;
+		int iY1;
+		int iY2;
+		double dDistDiff;
+	}
+	CROSS_MOVE_t;
+
+	typedef struct
+	{
+		int iPos1;
+		int iPos2;
+		double dDistDiff;
+	}
+	INTRA_MOVE_t;
+
+	// time window data of a sequence of nodes, sequences are concatenated
+	// in O(1) (Vidal et al. 2013); waiting is allowed, time warp is not
+	typedef struct
+	{
+		double dDuration;	// travel, service and waiting time
+		double dEarliest;	// earliest start of service at the first node
+		double dLatest;		// latest start of service at the first node
+		double dTimeWarp;	// > 0.0: not feasible
+		int iLoad;
+		int iFirst;
+		int iLast;
+	}
+	SEGMENT_t;
+
+	// summary of a route to prune the route pairs of the cross exchange
+	typedef struct
+	{
+		int iMinXCoord;			// bounding box of the customers
+		int iMaxXCoord;
+		int iMinYCoord;
+		int iMaxYCoord;
+		double dFirstDeparture;	// departure at the first customer
+		int iLatestDueDate;		// latest due date of customers 2..n
+	}
+	ROUTE_SUMMARY_t;
+
+	// jobs of the parallel local search
+	typedef struct
+	{
+		Vrptw *pVrptw;
+		int **ppiTourMatrix;
+		bool *pbAbort;
+		int iAborted;		// set by the jobs
+		int iJobCount;
+		int *piPairs;		// route 1 and route 2 of every pair
+		int *piJobs;		// pairs to evaluate
+		CROSS_MOVE_t *pMoves; // best move of every pair
+		char *pScratch;		// schedules, one per thread
+		int iScratchSize;
+		double *pdDistDiff;	// intra exchange: dist diff of every route
+		bool *pbDontLook;
+	}
+	LS_JOBS_t;
+
 	InstanceData *m_pInstanceData;
 
+	// max. length of the exchanged segments (0 = unbounded)
+	int m_iCrossMaxSegmentLength;
+
+	// max. distance of the routes of a cross exchange (0.0 = unbounded)
+	double m_dCrossMaxRouteDistance;
+
+	// intra exchange
+	int m_iIntraMoveOrder;
+	int m_iIntraCandidates;
+
+	// threads of the parallel local search
+	int m_iLocalSearchThreads;
+	WorkerPool *m_pLocalSearchPool;
+
+	// buffers of the local search if the caller doesn't pass an arena
+	ScratchArena *m_pScratchArena;
+
+	// intra exchange results of recurring routes
+	int m_iRouteCacheSize;
+	RouteCache *m_pRouteCache;
+
+	// variable neighborhood descent
+	int m_iVndOperatorCount;
+	int m_piVndOperators[LS_OPERATOR_COUNT];
+	int m_piVndBudget[LS_OPERATOR_COUNT];
+	bool m_bVndAdaptive;
+	bool m_bReproducible;	// no decisions on measured times or shared caches
+	pthread_mutex_t m_mutexVndStatistics;
+	double m_pdVndGain[LS_OPERATOR_COUNT];
+	long long m_pllVndMicroseconds[LS_OPERATOR_COUNT];
+
+	void initLocalSearch();
+
+	int ls_run_operator(int iOperator,
+						int iVehicleCount,
+						double *pdTotalDistance,
+						int **ppiTourMatrix,
+						bool *pbAbort,
+						LS_STATE_t *pState);
+
+	void sortVndOperators();
+
 	void convertToTourMatrix(int iVehicleCount,
 							 int *piTours,
 							 int **ppiTourMatrix);
@@ -128,6 +398,165 @@ protected:
 							   int *piTours,
 							   int **ppiTourMatrix);
 
+	int startLocalSearchPool();
+
+	WorkerPool *getLocalSearchPool(LS_STATE_t *pState);
+
+	int prepareScratchArena(int iSize);
+
+	ScratchArena *getScratchArena(int iVehicleCount,
+								  LS_STATE_t *pState);
+
+	bool checkTourMatrix(int iVehicleCount,
+						 int **ppiTourMatrix,
+						 double *pdTotalDistance,
+						 ScratchArena *pArena);
+
+	int getRoutePairScheduleSize();
+
+	int ls_cross_exchange_route_pair(int *piTour1,
+									 int *piTour2,
+									 char *pSchedule,
+									 bool *pbAbort,
+									 CROSS_MOVE_t *pMove);
+
+	void calcRouteSummary(int *piTour,
+						  ROUTE_SUMMARY_t *pSummary);
+
+	bool isRoutePairPromising(const ROUTE_SUMMARY_t *pSummary1,
+							  const ROUTE_SUMMARY_t *pSummary2);
+
+	int ls_cross_exchange_filter(const double *pdRowY1,
+								 const double *pdRowY1Next,
+								 double dArcY1,
+								 const int *piTour2,
+								 const int *piNext2,
+								 const double *pdArc2,
+								 int iFirstY2,
+								 int iLastY2,
+								 double dBound,
+								 bool *pbAbort,
+								 int *piCandidates,
+								 double *pdDistDiff);
+
+	static void ls_cross_exchange_job(void *pArg, int iJob, int iThread);
+
+	static int compareCrossMoves(const void *pMove1, const void *pMove2);
+
+	int ls_intra_exchange_route(int *piTour,
+								double *pdArcs,
+								double *pdDistDiff,
+								bool *pbAbort,
+								bool *pbDontLook);
+
+	int ls_intra_exchange_best_moves(int *piTour,
+									 double *pdArcs,
+									 bool *pbDontLook,
+									 INTRA_MOVE_t *pMoves);
+
+	void addIntraMove(int iPos1,
+					  int iPos2,
+					  double dDistDiff,
+					  INTRA_MOVE_t *pMoves,
+					  int *piCount,
+					  int iMaxCount);
+
+	bool isIntraMoveOverlapping(const INTRA_MOVE_t *pMove,
+								const INTRA_MOVE_t *pApplied,
+								int iAppliedCount);
+
+	bool isIntraSwapFeasible(int *piTour,
+							 int i,
+							 int j);
+
+	void swapIntraCustomers(int *piTour,
+							int i,
+							int j,
+							bool *pbDontLook);
+
+	int getIntraRouteScratchSize();
+
+	int prepareRouteCache();
+
+	int ls_intra_exchange_route_cached(int *piTour,
+									   char *pScratch,
+									   double *pdDistDiff,
+									   bool *pbAbort,
+									   bool *pbDontLook);
+
+	double calcTourDistance(int *piTour);
+
+	void clearDontLookBits(int *piTour,
+						   int iPos,
+						   bool *pbDontLook);
+
+	void markRouteChanged(int iRoute,
+						  LS_STATE_t *pState);
+
+	bool isRouteDirty(int iOperator,
+					  int iRoute,
+					  LS_STATE_t *pState)
+		{ return pState == NULL || pState->pbRouteDirty[iOperator][iRoute]; };
+
+	void beginLocalSearchPass(int iVehicleCount,
+							  LS_STATE_t *pState);
+
+	void endLocalSearchPass(int iOperator,
+							int iVehicleCount,
+							LS_STATE_t *pState);
+
+	void initSegment(int iNode,
+					 SEGMENT_t *pSegment);
+
+	void concatSegments(const SEGMENT_t *pSegment1,
+						const SEGMENT_t *pSegment2,
+						SEGMENT_t *pResult);
+
+	bool isSegmentFeasible(const SEGMENT_t *pSegment);
+
+	void calcTourSegments(int *piTour,
+						  SEGMENT_t *pPrefix,
+						  SEGMENT_t *pSuffix);
+
+	bool checkTour(int *piTour);
+
+	int ls_apply_route_pair_move(int iRoute1,
+								 int iRoute2,
+								 CROSS_MOVE_t *pMove,
+								 int **ppiTourMatrix,
+								 int *piTempTour1,
+								 int *piTempTour2,
+								 LS_STATE_t *pState);
+
+	void ls_relocate_route_pair(int *piTour1,
+								int *piTour2,
+								SEGMENT_t *pSegments,
+								CROSS_MOVE_t *pMove);
+
+	void ls_or_opt_route(int *piTour,
+						 SEGMENT_t *pSegments,
+						 int *piTempTour,
+						 double *pdDistDiff,
+						 bool *pbDontLook);
+
+	void ls_two_opt_star_route_pair(int *piTour1,
+									int *piTour2,
+									SEGMENT_t *pSegments,
+									CROSS_MOVE_t *pMove);
+
+	void applyCrossMoveToState(int iRoute1,
+							   int iRoute2,
+							   CROSS_MOVE_t *pMove,
+							   int **ppiTourMatrix,
+							   LS_STATE_t *pState);
+
+	static void ls_intra_exchange_job(void *pArg, int iJob, int iThread);
+
+	void calcTourSchedule(int *piTour,
+						  double *pdDeparture,
+						  double *pdLatestArrival,
+						  int *piLoad);
+
 	void ls_cross_exchange_tour(int iX1,
 								int iX2,
 								int iY1,
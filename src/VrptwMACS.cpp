@@ -37,7 +37,13 @@
 #include "InstanceData.h"
 #include "utils.h"
 #include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <limits.h>
 #include <time.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 
 ///// classes /////
@@ -62,47 +68,59 @@ VrptwMACS::VrptwMACS(InstanceData *pInstanceData,
 VrptwMACS::~VrptwMACS()
 {
 	cleanup();
+
+	m_ColonyPool.stop();
+
+	if (m_pIslandPools != NULL)
+		delete [] m_pIslandPools; // stops the threads
 }
 
 void VrptwMACS::init()
 {
 	m_bMutexBetterSolution = false;
 	m_bCondBetterSolution = false;
-	m_bRWLockBestSoFar = false;
+	m_bMutexSolutionLogger = false;
+	m_bMutexColonies = false;
+	m_bCondColonies = false;
 
 	m_iAntsCount = 10;
 	m_nBeta = 1;
 	m_dQ0 = 0.9;
 	m_dRho = 0.1;
 	m_dXi = 0.1;
+	m_iCandidateListSize = 0;
+	m_iSparsePheromoneNodes = 0;
+	m_dPheromoneSmoothing = 0.1;
+	m_iAntThreads = 0;
+	m_iIslandCount = 1;
+	m_iMigrationInterval = 10;
+	m_uSeed = 0;
+	m_iMaxIterations = 0;
 	
-	m_ppiTourMatrix_bestsofar = NULL;
-	m_ppiTourMatrix_acsvei = NULL;
+	m_pBestSoFar = NULL;
+	m_pRetiredSnapshots = NULL;
+	m_uSnapshotEpoch = 0;
+	m_ppiCandidateList = NULL;
+	m_iCandidateListLength = 0;
 	
-	m_ppdPheromoneMatrix_vei = NULL;
-	m_piIN_vei = NULL;
-
-	m_ppdPheromoneMatrix_time = NULL;
-
-	m_ppdPheromoneMatrix_vei = NULL;
-	m_piIN_vei = NULL;
-	m_pbNodesVisited_vei = NULL;
-	m_pdProbability_vei = NULL;
-	m_ppiTourMatrix_vei = NULL;
-	m_piCustomersToVisit_vei = NULL;
-	m_pdLatestArrivals_vei = NULL;
-
-	m_ppdPheromoneMatrix_time = NULL;
-	m_pbNodesVisited_time = NULL;
-	m_pdProbability_time = NULL;
-	m_ppiTourMatrix_time = NULL;
-	m_ppiTourMatrix_newbest_time = NULL;
-	m_piCustomersToVisit_time = NULL;
-	m_pdLatestArrivals_time = NULL;
+	m_pIslands = NULL;
+	m_iIslands = 0;
+	m_pIslandPools = NULL;
+	m_iIslandPools = 0;
+	m_iRestartVehicleCount = 0;
+	m_bSynchronized = false;
+	m_iLimitReached = 0;
+	m_iIterations = 0;
+	m_iRounds = 0;
+	m_iColonies = 0;
+	m_iColoniesArrived = 0;
+	m_uMeeting = 0;
 }
 
 void VrptwMACS::cleanup()
 {
+	int i;
+
 	if (m_bMutexBetterSolution)
 	{
 		pthread_mutex_destroy(&m_mutexBetterSolution);
@@ -115,123 +133,59 @@ void VrptwMACS::cleanup()
 		m_bCondBetterSolution = false;
 	}
 
-	if (m_bRWLockBestSoFar)
-	{
-		pthread_rwlock_destroy(&m_rwlockBestSoFar);
-		m_bRWLockBestSoFar = false;
-	}
-
-	if (m_ppiTourMatrix_bestsofar != NULL)
-	{
-		free(m_ppiTourMatrix_bestsofar);
-		m_ppiTourMatrix_bestsofar = NULL;
-	}
-
-	if (m_ppiTourMatrix_acsvei != NULL)
-	{
-		free(m_ppiTourMatrix_acsvei);
-		m_ppiTourMatrix_acsvei = NULL;
-	}
-
-	if (m_ppdPheromoneMatrix_vei != NULL)
-	{
-		free(m_ppdPheromoneMatrix_vei);
-		m_ppdPheromoneMatrix_vei = NULL;
-	}
-
-	if (m_piIN_vei != NULL)
-	{
-		free(m_piIN_vei);
-		m_piIN_vei = NULL;
-	}
-
-	if (m_pbNodesVisited_vei != NULL)
-	{
-		free(m_pbNodesVisited_vei);
-		m_pbNodesVisited_vei = NULL;
-	}
-
-	if (m_pdProbability_vei != NULL)
-	{
-		free(m_pdProbability_vei);
-		m_pdProbability_vei = NULL;
-	}
-
-	if (m_ppiTourMatrix_vei != NULL)
-	{
-		free(m_ppiTourMatrix_vei);
-		m_ppiTourMatrix_vei = NULL;
-	}
-
-	if (m_piCustomersToVisit_vei != NULL)
-	{
-		free(m_piCustomersToVisit_vei);
-		m_piCustomersToVisit_vei = NULL;
-	}
-
-	if (m_pdLatestArrivals_vei != NULL)
+	if (m_bMutexSolutionLogger)
 	{
-		free(m_pdLatestArrivals_vei);
-		m_pdLatestArrivals_vei = NULL;
+		pthread_mutex_destroy(&m_mutexSolutionLogger);
+		m_bMutexSolutionLogger = false;
 	}
 
-	if (m_ppdPheromoneMatrix_time != NULL)
+	if (m_bMutexColonies)
 	{
-		free(m_ppdPheromoneMatrix_time);
-		m_ppdPheromoneMatrix_time = NULL;
+		pthread_mutex_destroy(&m_mutexColonies);
+		m_bMutexColonies = false;
 	}
 
-	if (m_pbNodesVisited_time != NULL)
+	if (m_bCondColonies)
 	{
-		free(m_pbNodesVisited_time);
-		m_pbNodesVisited_time = NULL;
+		pthread_cond_destroy(&m_condColonies);
+		m_bCondColonies = false;
 	}
 
-	if (m_pdProbability_time != NULL)
+	if (m_ppiCandidateList != NULL)
 	{
-		free(m_pdProbability_time);
-		m_pdProbability_time = NULL;
+		free(m_ppiCandidateList);
+		m_ppiCandidateList = NULL;
+		m_iCandidateListLength = 0;
 	}
 
-	if (m_ppiTourMatrix_time != NULL)
+	// islands
+	if (m_pIslands != NULL)
 	{
-		free(m_ppiTourMatrix_time);
-		m_ppiTourMatrix_time = NULL;
-	}
+		for (i=0; i<m_iIslands; i++)
+			freeIsland(&m_pIslands[i]);
 
-	if (m_ppiTourMatrix_newbest_time != NULL)
-	{
-		free(m_ppiTourMatrix_newbest_time);
-		m_ppiTourMatrix_newbest_time = NULL;
+		delete [] m_pIslands;
+		m_pIslands = NULL;
+		m_iIslands = 0;
 	}
 
-	if (m_piCustomersToVisit_time != NULL)
-	{
-		free(m_piCustomersToVisit_time);
-		m_piCustomersToVisit_time = NULL;
-	}
+	// snapshots
+	releaseSnapshot(m_pBestSoFar);
+	m_pBestSoFar = NULL;
 
-	if (m_pdLatestArrivals_time != NULL)
-	{
-		free(m_pdLatestArrivals_time);
-		m_pdLatestArrivals_time = NULL;
-	}
+	freeRetiredSnapshots();
 }
 
 int VrptwMACS::run(int iCalcSeconds)
 {
-	bool bError, bAcsVeiRunning, bAcsTimeRunning;
-	int i, j, iCount, iMaxNodes, iVehicleCount;
+	bool bError, bSparse;
+	int i, j, iCount, iMaxNodes, iVehicleCount, iIsland;
 	int *piNext, *piTours;
+	int **ppiTourMatrix;
+	ISLAND_t *pIsland;
+	SNAPSHOT_t *pSnapshot;
 
-	pthread_t pthreadSelfID;
-	pthread_t pthreadAcsVeiID;
-	pthread_t pthreadAcsTimeID;
-	void *pThreadReturn;
 	struct timespec tsCancel;
-	struct sched_param schedParamMain;
-	struct sched_param schedParamVei;
-	struct sched_param schedParamTime;
 
 	// check params
 	if (m_pInstanceData == NULL
@@ -243,16 +197,7 @@ int VrptwMACS::run(int iCalcSeconds)
 	// cleanup
 	cleanup();
 
-	// init random number generator
-#ifdef _DEBUG
-	m_MTRand_vei.seed(1805017555); // everytime the same random numbers
-	m_MTRand_time.seed(555180501); // everytime the same random numbers
-#else
-	m_MTRand_vei.seed();
-	m_MTRand_time.seed();
-#endif
-
-	// init mutex, condition variable and rw-lock
+	// init mutexes and condition variable
 	if (pthread_mutex_init(&m_mutexBetterSolution, NULL) != 0)
 		return -2;
 
@@ -263,10 +208,20 @@ int VrptwMACS::run(int iCalcSeconds)
 
 	m_bCondBetterSolution = true;
 
-	if (pthread_rwlock_init(&m_rwlockBestSoFar, NULL) != 0)
+	if (pthread_mutex_init(&m_mutexSolutionLogger, NULL) != 0)
+		return -4;
+
+	m_bMutexSolutionLogger = true;
+
+	if (pthread_mutex_init(&m_mutexColonies, NULL) != 0)
+		return -4;
+
+	m_bMutexColonies = true;
+
+	if (pthread_cond_init(&m_condColonies, NULL) != 0)
 		return -4;
 
-	m_bRWLockBestSoFar = true;
+	m_bCondColonies = true;
 
 	// init vars
 	bError = false;
@@ -274,6 +229,12 @@ int VrptwMACS::run(int iCalcSeconds)
 	m_iCustomerCount = m_pInstanceData->getCustomerCount();
 	m_iToursMaxSize = m_iCustomerCount+1;
 
+	// lockstep with a seed, the local search mustn't decide on times then
+	m_bSynchronized = (m_uSeed != 0);
+	m_bReproducible = m_bSynchronized;
+	m_iLimitReached = 0;
+	m_iIterations = 0;
+
 	// solution logger
 	if (m_pSolutionLogger != NULL)
 	{
@@ -284,6 +245,30 @@ int VrptwMACS::run(int iCalcSeconds)
 		m_pSolutionLogger->addParameter("q0", m_dQ0);
 		m_pSolutionLogger->addParameter("rho", m_dRho);
 		m_pSolutionLogger->addParameter("xi", m_dXi);
+		m_pSolutionLogger->addParameter("candidate_list_size",
+										m_iCandidateListSize);
+		m_pSolutionLogger->addParameter("sparse_pheromone_nodes",
+										m_iSparsePheromoneNodes);
+		m_pSolutionLogger->addParameter("pheromone_smoothing",
+										m_dPheromoneSmoothing);
+		m_pSolutionLogger->addParameter("ant_threads", m_iAntThreads);
+		m_pSolutionLogger->addParameter("island_count", m_iIslandCount);
+		m_pSolutionLogger->addParameter("migration_interval",
+										m_iMigrationInterval);
+		m_pSolutionLogger->addParameter("seed", (int)m_uSeed);
+		m_pSolutionLogger->addParameter("max_iterations", m_iMaxIterations);
+		m_pSolutionLogger->addParameter("cross_max_segment_length",
+										m_iCrossMaxSegmentLength);
+		m_pSolutionLogger->addParameter("cross_max_route_distance",
+										m_dCrossMaxRouteDistance);
+		m_pSolutionLogger->addParameter("intra_move_order", m_iIntraMoveOrder);
+		m_pSolutionLogger->addParameter("intra_candidates", m_iIntraCandidates);
+		m_pSolutionLogger->addParameter("local_search_threads",
+										m_iLocalSearchThreads);
+		m_pSolutionLogger->addParameter("vnd_operator_count",
+										m_iVndOperatorCount);
+		m_pSolutionLogger->addParameter("vnd_adaptive", m_bVndAdaptive ? 1 : 0);
+		m_pSolutionLogger->addParameter("route_cache_size", m_iRouteCacheSize);
 	}
 
 	// initial solution
@@ -291,7 +276,8 @@ int VrptwMACS::run(int iCalcSeconds)
 		return -5;
 
 	iVehicleCount = m_pInstanceData->getSolutionVehicleCount();
-	iMaxNodes = m_iCustomerCount + iVehicleCount;
+	// the customers and one depot, the fleet size is only a counter
+	iMaxNodes = m_iCustomerCount + 1;
 
 	m_iDepotDueDate = m_pInstanceData->getDepotDueDate();
 	m_iCustomerCount = m_pInstanceData->getCustomerCount();
@@ -301,74 +287,71 @@ int VrptwMACS::run(int iCalcSeconds)
 	m_piCustomerServiceTime = m_pInstanceData->getCustomerServiceTime();
 
 	// allocate memory
-	m_ppiTourMatrix_bestsofar = generate_int_matrix(iVehicleCount,
-													m_iToursMaxSize+1);
-
-	m_ppiTourMatrix_acsvei = generate_int_matrix(iVehicleCount, m_iToursMaxSize+1);
-
-	m_ppdPheromoneMatrix_vei = generate_double_matrix(iMaxNodes, iMaxNodes);
-
-	m_piIN_vei = (int*)malloc(sizeof(int)*m_iCustomerCount);
-
-	m_pbNodesVisited_vei = (bool*)malloc(sizeof(bool)*iMaxNodes);
-
-	m_pdProbability_vei = (double*)malloc(sizeof(double)*iMaxNodes);
-
-	m_ppiTourMatrix_vei = generate_int_matrix(iVehicleCount, m_iToursMaxSize+1);
+	bSparse = (m_iSparsePheromoneNodes > 0 && iMaxNodes >= m_iSparsePheromoneNodes);
 
-	m_piCustomersToVisit_vei = (int*)malloc(sizeof(int)*(m_iCustomerCount+1));
-
-	m_pdLatestArrivals_vei = (double*)malloc(sizeof(double)*(m_iCustomerCount+1));
+	if (createCandidateLists() != 0
+		|| prepareRouteCache() != 0)
+	{
+		cleanup();
+		return -6;
+	}
 
-	m_ppdPheromoneMatrix_time = generate_double_matrix(iMaxNodes, iMaxNodes);
+	// the threads of the islands are kept for the next run with the same
+	// island count
+	if (m_iIslandPools != m_iIslandCount)
+	{
+		if (m_pIslandPools != NULL)
+			delete [] m_pIslandPools;
 
-	m_pbNodesVisited_time = (bool*)malloc(sizeof(bool)*iMaxNodes);
+		m_pIslandPools = new ISLAND_POOLS_t[m_iIslandCount];
+		m_iIslandPools = m_iIslandCount;
+	}
 
-	m_pdProbability_time = (double*)malloc(sizeof(double)*iMaxNodes);
+	m_pIslands = new ISLAND_t[m_iIslandCount];
 
-	m_ppiTourMatrix_time = generate_int_matrix(iVehicleCount, m_iToursMaxSize+1);
+	for (iIsland=0; iIsland<m_iIslandCount; iIsland++)
+	{
+		m_iIslands++;
 
-	m_ppiTourMatrix_newbest_time = generate_int_matrix(iVehicleCount,
-													   m_iToursMaxSize+1);
+		if (createIsland(&m_pIslands[iIsland], iIsland, iVehicleCount,
+						 bSparse) != 0)
+		{
+			cleanup();
+			return -6;
+		}
+	}
 
-	m_piCustomersToVisit_time = (int*)malloc(sizeof(int)*(m_iCustomerCount+1));
+	// the colonies run on persistent threads, which are kept for the next
+	// run with the same island count
+	if (m_ColonyPool.getThreadCount() != 2*m_iIslands)
+	{
+		if (m_ColonyPool.start(2*m_iIslands) != 0)
+		{
+			cleanup();
+			return -6;
+		}
+	}
 
-	m_pdLatestArrivals_time = (double*)malloc(sizeof(double)*(m_iCustomerCount+1));
+	// initial solution as the first snapshot
+	ppiTourMatrix = generate_int_matrix(iVehicleCount, m_iToursMaxSize+1);
 
-	if (m_ppiTourMatrix_bestsofar == NULL
-		|| m_ppiTourMatrix_acsvei == NULL
-		|| m_ppdPheromoneMatrix_vei == NULL
-		|| m_piIN_vei == NULL
-		|| m_pbNodesVisited_vei == NULL
-		|| m_pdProbability_vei == NULL
-		|| m_ppiTourMatrix_vei == NULL
-		|| m_piCustomersToVisit_vei == NULL
-		|| m_pdLatestArrivals_vei == NULL
-		|| m_ppdPheromoneMatrix_time == NULL
-		|| m_pbNodesVisited_time == NULL
-		|| m_pdProbability_time == NULL
-		|| m_ppiTourMatrix_time == NULL
-		|| m_ppiTourMatrix_newbest_time == NULL
-		|| m_piCustomersToVisit_time == NULL
-		|| m_pdLatestArrivals_time == NULL)
+	if (ppiTourMatrix == NULL)
 	{
 		cleanup();
 		return -6;
 	}
 
-	// copy initial solution to TourMatrix_bestsofar
-	piTours = m_pInstanceData->getSolutionTours(&m_iVehicleCount_bestsofar,
-												&m_dDistance_bestsofar);
+	piTours = m_pInstanceData->getSolutionTours(NULL, NULL);
 
 	piNext = piTours;
 
-	for (i=0; i<m_iVehicleCount_bestsofar; i++)
+	for (i=0; i<iVehicleCount; i++)
 	{
 		j = 0;
 
 		do
 		{
-			m_ppiTourMatrix_bestsofar[i][++j] = *piNext;	
+			ppiTourMatrix[i][++j] = *piNext;	
 			piNext++;
 		}
 		while (*piNext != -1);
@@ -376,115 +359,112 @@ int VrptwMACS::run(int iCalcSeconds)
 		piNext++;
 
 		// customer count
-		m_ppiTourMatrix_bestsofar[i][0] = j;
+		ppiTourMatrix[i][0] = j;
 
 		// starting depot
-		m_ppiTourMatrix_bestsofar[i][m_iToursMaxSize] = m_iCustomerCount+i;
+		ppiTourMatrix[i][m_iToursMaxSize] = m_iCustomerCount+i;
 	}
 
+	pSnapshot = createSnapshot(iVehicleCount,
+							   m_pInstanceData->getSolutionDistance(),
+							   ppiTourMatrix);
+
+	free(ppiTourMatrix);
+
+	if (pSnapshot == NULL)
+	{
+		cleanup();
+		return -6;
+	}
+
+	publishSnapshot(&m_pBestSoFar, pSnapshot);
+
 	// solution logger
 	if (m_pSolutionLogger != NULL)
-		m_pSolutionLogger->add(m_iVehicleCount_bestsofar, m_dDistance_bestsofar,
-							   m_ppiTourMatrix_bestsofar);
+		m_pSolutionLogger->add(pSnapshot->iVehicleCount, pSnapshot->dDistance,
+							   pSnapshot->ppiTourMatrix);
 
 	// calc cancel time
 	tsCancel.tv_sec = time(NULL) + iCalcSeconds;
 	tsCancel.tv_nsec = 0;
 
 	// pthread control
-	pthread_setconcurrency(3); 
-	pthreadSelfID = pthread_self();
-
-#if defined(WIN32) || defined(WIN64)
-	schedParamMain.sched_priority = sched_get_priority_max(SCHED_OTHER);
-	schedParamVei.sched_priority = schedParamMain.sched_priority-1;
-	schedParamTime.sched_priority = schedParamMain.sched_priority-1;
-
-	pthread_setschedparam(pthreadSelfID, SCHED_OTHER, &schedParamMain);
-#else
-	schedParamMain.sched_priority = 41;
-	schedParamVei.sched_priority = 40;
-	schedParamTime.sched_priority = 40;
-	// bug in linux kernel (e.g. 2.6.18-3-amd64)
-	// SCHED_RR does not work, no switch !!
-//!!!	pthread_setschedparam(pthreadSelfID, SCHED_RR, &schedParamMain);
-#endif
+	pthread_setconcurrency(2*m_iIslands+1); 
 
 	do
 	{
-		bAcsVeiRunning = bAcsTimeRunning = false;
 		m_bStopRunning = false;
 
-		pthread_mutex_lock(&m_mutexBetterSolution);
-
-		if (m_iVehicleCount_bestsofar > 1)
+		// every island starts with the best solution so far
+		for (iIsland=0; iIsland<m_iIslands; iIsland++)
 		{
-			// create ACS_VEI thread
-			if (pthread_create(&pthreadAcsVeiID, NULL, acs_vei, (void*)this) != 0)
-			{
-				pthread_mutex_unlock(&m_mutexBetterSolution);
-				bError = true;
-				break;
-			}
+			pIsland = &m_pIslands[iIsland];
 
-#if defined(WIN32) || defined(WIN64)
-			pthread_setschedparam(pthreadAcsVeiID, SCHED_OTHER, &schedParamVei);
-#else
-			// bug in linux kernel (e.g. 2.6.18-3-amd64)
-			// SCHED_RR does not work, no switch !!
-//!!!		pthread_setschedparam(pthreadAcsVeiID, SCHED_RR, &schedParamVei); 
-#endif
+			publishSnapshot(&pIsland->pBest, m_pBestSoFar);
+			pIsland->Mailbox.clear();
+
+			pIsland->uEpoch_vei = m_uSnapshotEpoch;
+			pIsland->uEpoch_time = m_uSnapshotEpoch;
+		}
+
+		// no colony is running, nobody reads the retired snapshots
+		freeRetiredSnapshots();
 
-			bAcsVeiRunning = true;
+		m_iRestartVehicleCount = m_pBestSoFar->iVehicleCount;
+
+		// the running colonies meet after every iteration
+		if (m_bSynchronized)
+		{
+			m_iColonies = m_iRestartVehicleCount > 1 ? 2*m_iIslands : m_iIslands;
+			m_iColoniesArrived = 0;
+			m_iRounds = 0;
 		}
 
-		// create ACS_TIME thread
-		if (pthread_create(&pthreadAcsTimeID, NULL, acs_time, (void*)this) != 0)
+		pthread_mutex_lock(&m_mutexBetterSolution);
+
+		// restart the colonies
+		if (m_ColonyPool.post(2*m_iIslands, colony_job, (void*)this) != 0)
 		{
 			pthread_mutex_unlock(&m_mutexBetterSolution);
 			bError = true;
 			break;
-
-#if defined(WIN32) || defined(WIN64)
-			pthread_setschedparam(pthreadAcsTimeID, SCHED_OTHER, &schedParamTime);
-#else
-			// bug in linux kernel (e.g. 2.6.18-3-amd64)
-			// SCHED_RR does not work, no switch !!
-//!!!		pthread_setschedparam(pthreadAcsTimeID, SCHED_RR, &schedParamTime);
-#endif
 		}
 
-		bAcsTimeRunning = true;
+		// wait for a feasible solution with lower vehicle count, colonies
+		// in lockstep stop themselves after an iteration
+		do
+		{
+			i = pthread_cond_timedwait(&m_condBetterSolution,
+									   &m_mutexBetterSolution, &tsCancel);
+		}
+		while (i == 0 && m_bSynchronized && m_bStopRunning == false);
 
-		// wait for a feasible solution with lower vehicle count
-		if (pthread_cond_timedwait(&m_condBetterSolution, &m_mutexBetterSolution,
-								   &tsCancel) != 0)
+		if (i != 0)
 		{
-			m_bStopRunning = true;
+			if (m_bSynchronized)
+				IntAtomicStore(&m_iLimitReached, 1);
+			else
+				m_bStopRunning = true;
+
 			pthread_mutex_unlock(&m_mutexBetterSolution);
 			break; // ETIMEDOUT
 		}
 
-		m_bStopRunning = true;
+		if (m_bSynchronized == false)
+			m_bStopRunning = true;
+
 		pthread_mutex_unlock(&m_mutexBetterSolution);
 
-		// wait for exit of thread ACS_VEI
-		if (bAcsVeiRunning)
-			pthread_join(pthreadAcsVeiID, &pThreadReturn);
+		// wait for exit of the colonies
+		m_ColonyPool.wait();
 
-		// wait for exit of thread ACS_TIME
-		if (bAcsTimeRunning)
-			pthread_join(pthreadAcsTimeID, &pThreadReturn);
+		if (IntAtomicLoad(&m_iLimitReached) != 0)
+			break;
 	}
 	while (true);
 
-	// wait for exit of thread ACS_VEI
-	if (bAcsVeiRunning)
-		pthread_join(pthreadAcsVeiID, &pThreadReturn);
-
-	// wait for exit of thread ACS_TIME
-	if (bAcsTimeRunning)
-		pthread_join(pthreadAcsTimeID, &pThreadReturn);
+	// wait for exit of the colonies
+	m_ColonyPool.wait();
 
 	if (bError)
 	{
@@ -493,15 +473,16 @@ int VrptwMACS::run(int iCalcSeconds)
 	}
 
 	// convert TourMatrix to piTours
+	pSnapshot = m_pBestSoFar;
 	piNext = piTours;
 
-	for (i=0; i<m_iVehicleCount_bestsofar; i++)
+	for (i=0; i<pSnapshot->iVehicleCount; i++)
 	{
-		iCount = m_ppiTourMatrix_bestsofar[i][0];
+		iCount = pSnapshot->ppiTourMatrix[i][0];
 
 		for (j=1; j<=iCount; j++)
 		{
-			*piNext = m_ppiTourMatrix_bestsofar[i][j];
+			*piNext = pSnapshot->ppiTourMatrix[i][j];
 			piNext++;
 		}
 
@@ -509,63 +490,87 @@ int VrptwMACS::run(int iCalcSeconds)
 		piNext++;
 	}
 
-	m_pInstanceData->setSolutionVehicleCount(m_iVehicleCount_bestsofar);
-	m_pInstanceData->setSolutionDistance(m_dDistance_bestsofar);
+	m_pInstanceData->setSolutionVehicleCount(pSnapshot->iVehicleCount);
+	m_pInstanceData->setSolutionDistance(pSnapshot->dDistance);
 
 	cleanup();
 
 	return 0;
 }
 
+// job iIsland*2 is the acs_vei colony of the island, iIsland*2+1 its
+// acs_time colony
+void VrptwMACS::colony_job(void *pArg,
+						   int iJob,
+						   int iThread)
+{
+	VrptwMACS *pMACS;
+	ISLAND_t *pIsland;
+
+	pMACS = (VrptwMACS *)pArg;
+	pIsland = &pMACS->m_pIslands[iJob >> 1];
+
+	if (iJob & 1)
+	{
+		acs_time((void*)pIsland);
+		UIntAtomicStore(&pIsland->uEpoch_time, UINT_MAX);
+	}
+	else
+	{
+		if (pMACS->m_iRestartVehicleCount > 1)
+			acs_vei((void*)pIsland);
+
+		UIntAtomicStore(&pIsland->uEpoch_vei, UINT_MAX);
+	}
+}
+
 void *VrptwMACS::acs_vei(void *pArg)
 {
 	bool bBetterSolutionFound;
-	int i, j, iM, iN, iNodes, iAnt, iAntsCount, iToursMaxSize;
+	int i, j, iNodes, iAnt, iAntsCount, iToursMaxSize;
 	int iCount, iCustomerCount, iNextNode, iLastNode, iVehicleCount_special;
 	int iVisitedCustomers, iVisitedCustomers_acsvei, iToursVehicleCount;
 	double dTau0, dToursDistance, dDistance_acsvei, dTmp1, dTmp2;
-	bool *pbNodesVisited_vei;
+	unsigned int *puNodesVisited;
 	int *piIN_vei, *piNext;
-	int **ppiTourMatrix, **ppiTourMatrix_acsvei, **ppiTourMatrix_bestsofar;
+	int *piArcs;
+	int **ppiTourMatrix, **ppiTourMatrix_acsvei;
 	VrptwMACS *pMACS;
+	ISLAND_t *pIsland;
+	SNAPSHOT_t *pBest, *pSnapshot;
 	InstanceData *pInstanceData;
-	double **ppdPheromoneMatrix;
+	PheromoneTable *pPheromone;
+	ANT_t *pAnts, *pAnt;
 
-	pMACS = (VrptwMACS *)pArg;
+	pIsland = (ISLAND_t *)pArg;
+	pMACS = pIsland->pMACS;
 
 	pInstanceData = pMACS->m_pInstanceData;
-	pbNodesVisited_vei = pMACS->m_pbNodesVisited_vei;
-	piIN_vei = pMACS->m_piIN_vei;
-	ppdPheromoneMatrix = pMACS->m_ppdPheromoneMatrix_vei;
-	ppiTourMatrix_bestsofar = pMACS->m_ppiTourMatrix_bestsofar;
-	ppiTourMatrix = pMACS->m_ppiTourMatrix_vei;
-	ppiTourMatrix_acsvei = pMACS->m_ppiTourMatrix_acsvei;
+	piIN_vei = pIsland->piIN_vei;
+	pPheromone = &pIsland->Pheromone_vei;
+	pAnts = pIsland->pAnts_vei;
+	ppiTourMatrix_acsvei = pIsland->ppiTourMatrix_acsvei;
 
 	iCustomerCount = pMACS->m_iCustomerCount;
 	iAntsCount = pMACS->m_iAntsCount;
 	iToursMaxSize = pMACS->m_iToursMaxSize;
 
-	// read shared resource
-	pthread_rwlock_rdlock(&pMACS->m_rwlockBestSoFar);
-	iVehicleCount_special = pMACS->m_iVehicleCount_bestsofar-1;
-	pthread_rwlock_unlock(&pMACS->m_rwlockBestSoFar);
+	iVehicleCount_special = pMACS->m_iRestartVehicleCount-1;
 
-	// initialize
+	// initialize, tau0 still counts one depot per vehicle
 	iNodes = iCustomerCount+iVehicleCount_special;
 	
 	dTau0 = 1.0;
 	dTau0 /= iNodes * pInstanceData->getSolutionDistance();
 
-	for (iM=0; iM<iNodes; iM++)
-	{
-		for (iN=0; iN<iNodes; iN++)
-			ppdPheromoneMatrix[iM][iN] = dTau0;
-	}
+	// keep what the previous colony learned
+	pPheromone->rescale(dTau0, pMACS->m_dPheromoneSmoothing);
 
 	for (i=0; i<iCustomerCount; i++)
 		piIN_vei[i] = 0;
 
 	bBetterSolutionFound = false;
+	pIsland->pFound_vei = NULL;
 
 	// copy initial solution to TourMatrix_acsvei
 	iVisitedCustomers_acsvei = 0;
@@ -596,43 +601,52 @@ void *VrptwMACS::acs_vei(void *pArg)
 
 	do
 	{
+		// no snapshot is held here
+		pMACS->quiesce(&pIsland->uEpoch_vei);
+
+		// construct the solutions of all ants at once
+		if (pMACS->m_iAntThreads > 0)
+			pMACS->construct_ants(pIsland, true, dTau0, iVehicleCount_special);
+
 		for (iAnt=0; iAnt<iAntsCount; iAnt++)
 		{
 			if (pMACS->m_bStopRunning)
 				return NULL;
 
 			// contruct a solution
-			while (pMACS->new_active_ant(true, iNodes, dTau0, iVehicleCount_special,
-										 &iToursVehicleCount, &dToursDistance))
+			if (pMACS->m_iAntThreads > 0)
+				pAnt = &pAnts[iAnt];
+			else
+			{
+				pAnt = &pAnts[0];
+				pMACS->new_active_ant(pAnt, dTau0, iVehicleCount_special);
+			}
+
+			iToursVehicleCount = pAnt->iToursVehicleCount;
+			dToursDistance = pAnt->dToursDistance;
+			puNodesVisited = pAnt->puNodesVisited;
+			ppiTourMatrix = pAnt->ppiTourMatrix;
+
+			if (pAnt->bFeasible)
 			{
 				// feasible solution found
 				// -> save the solution and inform the main process
 
-				// lock shared resource (write)
-				pthread_rwlock_wrlock(&pMACS->m_rwlockBestSoFar);
+				pSnapshot = pMACS->createSnapshot(iToursVehicleCount,
+												  dToursDistance, ppiTourMatrix);
 
-				if (iToursVehicleCount >= pMACS->m_iVehicleCount_bestsofar)
+				// published at the end of the iteration in lockstep
+				if (pMACS->m_bSynchronized)
 				{
-					// unlock shared resource (write)
-					pthread_rwlock_unlock(&pMACS->m_rwlockBestSoFar);
-
-					return NULL;
+					pIsland->pFound_vei = pSnapshot;
+					break;
 				}
 
-				pMACS->m_iVehicleCount_bestsofar = iToursVehicleCount;
-				pMACS->m_dDistance_bestsofar = dToursDistance;
-				CopyTourMatrix(iToursVehicleCount, iToursMaxSize,
-							   pMACS->m_ppiTourMatrix_bestsofar, ppiTourMatrix);
-
-				// solution logger
-				if (pMACS->m_pSolutionLogger != NULL)
-				{
-					pMACS->m_pSolutionLogger->add(iToursVehicleCount,
-												  dToursDistance, ppiTourMatrix);
-				}
+				// a worse snapshot is retired by publishBestSoFar
+				if (pSnapshot == NULL || pMACS->publishBestSoFar(pSnapshot) == false)
+					return NULL;
 
-				// unlock shared resource (write)
-				pthread_rwlock_unlock(&pMACS->m_rwlockBestSoFar);
+				pMACS->logSolution(pSnapshot);
 
 				// inform the main process
 				pthread_mutex_lock(&pMACS->m_mutexBetterSolution);
@@ -650,7 +664,7 @@ void *VrptwMACS::acs_vei(void *pArg)
 
 			for (i=0; i<iCustomerCount; i++)
 			{
-				if (pbNodesVisited_vei[i] == false)
+				if (BITSET_TEST(puNodesVisited, i) == 0)
 					piIN_vei[i]++;
 				else
 					iVisitedCustomers++;
@@ -679,7 +693,7 @@ void *VrptwMACS::acs_vei(void *pArg)
 		dTmp1 = 1.0-pMACS->m_dRho;
 		dTmp2 = pMACS->m_dRho/dDistance_acsvei;
 
-		iLastNode = ppiTourMatrix_acsvei[0][iToursMaxSize];
+		iLastNode = iCustomerCount;
 
 		for (i=0; i<iVehicleCount_special; i++)
 		{
@@ -689,61 +703,32 @@ void *VrptwMACS::acs_vei(void *pArg)
 			for (j=1; j<=iCount; j++)
 			{
 				iNextNode = ppiTourMatrix_acsvei[i][j];
-				ppdPheromoneMatrix[iLastNode][iNextNode] *= dTmp1;
-				ppdPheromoneMatrix[iLastNode][iNextNode] += dTmp2;
+				pPheromone->update(iLastNode, iNextNode, dTmp1, dTmp2);
 				iLastNode = iNextNode;
 			}
 
 			// back to depot
-			if (i < iVehicleCount_special-1)
-				iNextNode = ppiTourMatrix_acsvei[i+1][iToursMaxSize];
-			else
-				iNextNode = ppiTourMatrix_acsvei[0][iToursMaxSize];
+			iNextNode = iCustomerCount;
 
-			ppdPheromoneMatrix[iLastNode][iNextNode] *= dTmp1;
-			ppdPheromoneMatrix[iLastNode][iNextNode] += dTmp2;
+			pPheromone->update(iLastNode, iNextNode, dTmp1, dTmp2);
 			iLastNode = iNextNode;
 		}
 
 		if (pMACS->m_bStopRunning)
 			return NULL;
 
-		// lock shared resource (read)
-		pthread_rwlock_rdlock(&pMACS->m_rwlockBestSoFar);
-
-		// perform global updating with TourMatrix_bestsofar
-		dTmp1 = 1.0-pMACS->m_dRho;
-		dTmp2 = pMACS->m_dRho/pMACS->m_dDistance_bestsofar;
-
-		iLastNode = ppiTourMatrix_bestsofar[0][iToursMaxSize];
-		iToursVehicleCount = pMACS->m_iVehicleCount_bestsofar;
-
-		for (i=0; i<iToursVehicleCount; i++)
-		{
-			// from depot to customers
-			iCount = ppiTourMatrix_bestsofar[i][0];
-
-			for (j=1; j<=iCount; j++)
-			{
-				iNextNode = ppiTourMatrix_bestsofar[i][j];
-				ppdPheromoneMatrix[iLastNode][iNextNode] *= dTmp1;
-				ppdPheromoneMatrix[iLastNode][iNextNode] += dTmp2;
-				iLastNode = iNextNode;
-			}
+		if (pMACS->m_bSynchronized && pMACS->synchronize())
+			return NULL;
 
-			// back to depot
-			if (i < iToursVehicleCount-1)
-				iNextNode = ppiTourMatrix_bestsofar[i+1][iToursMaxSize];
-			else
-				iNextNode = ppiTourMatrix_bestsofar[0][iToursMaxSize];
+		// perform global updating with the best solution of the island
+		pBest = readSnapshot(&pIsland->pBest);
+		piArcs = pBest->piArcs;
 
-			ppdPheromoneMatrix[iLastNode][iNextNode] *= dTmp1;
-			ppdPheromoneMatrix[iLastNode][iNextNode] += dTmp2;
-			iLastNode = iNextNode;
-		}
+		dTmp1 = 1.0-pMACS->m_dRho;
+		dTmp2 = pMACS->m_dRho/pBest->dDistance;
 
-		// unlock shared resource
-		pthread_rwlock_unlock(&pMACS->m_rwlockBestSoFar);
+		for (i=0; i<pBest->iArcCount; i++)
+			pPheromone->update(piArcs[2*i], piArcs[2*i+1], dTmp1, dTmp2);
 	}
 	while (pMACS->m_bStopRunning == false);
 
@@ -753,49 +738,59 @@ void *VrptwMACS::acs_vei(void *pArg)
 void *VrptwMACS::acs_time(void *pArg)
 {
 	bool bNoData;
-	int i, j, iCount, iLastNode, iNextNode;
-	int iM, iN, iNodes, iAnt, iVehicleCount_bestsofar, iToursVehicleCount;
+	int i, iIteration;
+	int iNodes, iAnt, iVehicleCount_bestsofar, iToursVehicleCount;
 	int iCustomerCount, iAntsCount, iToursMaxSize;
 	double dTmp1, dTmp2;
-	double dTau0, dDistance_newbest, dToursDistance, dDistance_bestsofar;
-	int **ppiTourMatrix, **ppiTourMatrix_newbest, **ppiTourMatrix_bestsofar;
+	double dTau0, dDistance_newbest, dToursDistance;
+	int *piArcs;
+	int **ppiTourMatrix, **ppiTourMatrix_newbest;
 	VrptwMACS *pMACS;
+	ISLAND_t *pIsland;
+	SNAPSHOT_t *pBest, *pSnapshot;
 	InstanceData *pInstanceData;
-	double **ppdPheromoneMatrix;
+	PheromoneTable *pPheromone;
+	ANT_t *pAnts, *pAnt;
 
-	pMACS = (VrptwMACS *)pArg;
+	pIsland = (ISLAND_t *)pArg;
+	pMACS = pIsland->pMACS;
 
 	pInstanceData = pMACS->m_pInstanceData;
-	ppdPheromoneMatrix = pMACS->m_ppdPheromoneMatrix_time;
-	ppiTourMatrix_bestsofar = pMACS->m_ppiTourMatrix_bestsofar;
-	ppiTourMatrix = pMACS->m_ppiTourMatrix_time;
-	ppiTourMatrix_newbest = pMACS->m_ppiTourMatrix_newbest_time;
+	pPheromone = &pIsland->Pheromone_time;
+	pAnts = pIsland->pAnts_time;
+	ppiTourMatrix_newbest = pIsland->ppiTourMatrix_newbest_time;
 
 	iCustomerCount = pMACS->m_iCustomerCount;
 	iAntsCount = pMACS->m_iAntsCount;
 	iToursMaxSize = pMACS->m_iToursMaxSize;
 	
-	// read shared resource
-	pthread_rwlock_rdlock(&pMACS->m_rwlockBestSoFar);
-	iVehicleCount_bestsofar = pMACS->m_iVehicleCount_bestsofar;
-	iVehicleCount_bestsofar = pMACS->m_iVehicleCount_bestsofar;
-	pthread_rwlock_unlock(&pMACS->m_rwlockBestSoFar);
+	iVehicleCount_bestsofar = pMACS->m_iRestartVehicleCount;
 
-	// initialize
+	// initialize, tau0 still counts one depot per vehicle
 	iNodes = iCustomerCount+iVehicleCount_bestsofar;
 	
 	dTau0 = 1.0;
 	dTau0 /= iNodes * pInstanceData->getSolutionDistance();
 
-	for (iM=0; iM<iNodes; iM++)
-	{
-		for (iN=0; iN<iNodes; iN++)
-			ppdPheromoneMatrix[iM][iN] = dTau0;
-	}
+	// keep what the previous colony learned
+	pPheromone->rescale(dTau0, pMACS->m_dPheromoneSmoothing);
+
+	iIteration = 0;
 
 	do
 	{
+		// no snapshot is held here
+		pMACS->quiesce(&pIsland->uEpoch_time);
+
+		if (pIsland->iIsland == 0)
+			pMACS->reclaimSnapshots();
+
 		bNoData = true;
+		pIsland->pFound_time = NULL;
+
+		// construct the solutions of all ants at once
+		if (pMACS->m_iAntThreads > 0)
+			pMACS->construct_ants(pIsland, false, dTau0, iVehicleCount_bestsofar);
 
 		for (iAnt=0; iAnt<iAntsCount; iAnt++)
 		{
@@ -803,40 +798,42 @@ void *VrptwMACS::acs_time(void *pArg)
 				return NULL;
 
 			// contruct a solution
-			if (pMACS->new_active_ant(false, iNodes, dTau0, iVehicleCount_bestsofar,
-									  &iToursVehicleCount, &dToursDistance)
-									  == false)
+			if (pMACS->m_iAntThreads > 0)
+				pAnt = &pAnts[iAnt];
+			else
 			{
-				continue; // not feasible
+				pAnt = &pAnts[0];
+				pMACS->new_active_ant(pAnt, dTau0, iVehicleCount_bestsofar);
 			}
+
+			if (pAnt->bFeasible == false)
+				continue; // not feasible
+
+			iToursVehicleCount = pAnt->iToursVehicleCount;
+			dToursDistance = pAnt->dToursDistance;
+			ppiTourMatrix = pAnt->ppiTourMatrix;
 			
 			if (pMACS->m_bStopRunning)
 				return NULL;
 
-			while (iToursVehicleCount < iVehicleCount_bestsofar)
+			if (iToursVehicleCount < iVehicleCount_bestsofar)
 			{
-				// lock shared resource (write)
-				pthread_rwlock_wrlock(&pMACS->m_rwlockBestSoFar);
+				pSnapshot = pMACS->createSnapshot(iToursVehicleCount,
+												  dToursDistance, ppiTourMatrix);
 
-				if (iToursVehicleCount >= pMACS->m_iVehicleCount_bestsofar)
+				// published at the end of the iteration in lockstep
+				if (pMACS->m_bSynchronized)
 				{
-					// unlock shared resource
-					pthread_rwlock_unlock(&pMACS->m_rwlockBestSoFar);
-					return NULL;
+					pIsland->pFound_time = pSnapshot;
+					bNoData = true;
+					break;
 				}
 
-				pMACS->m_iVehicleCount_bestsofar = iToursVehicleCount;
-				pMACS->m_dDistance_bestsofar = dToursDistance;
-				CopyTourMatrix(iToursVehicleCount, iToursMaxSize,
-							   ppiTourMatrix_bestsofar, ppiTourMatrix);
-
-				// solution logger
-				if (pMACS->m_pSolutionLogger != NULL)
-					pMACS->m_pSolutionLogger->add(iToursVehicleCount,
-												  dToursDistance, ppiTourMatrix);
+				// a worse snapshot is retired by publishBestSoFar
+				if (pSnapshot == NULL || pMACS->publishBestSoFar(pSnapshot) == false)
+					return NULL;
 
-				// unlock shared resource
-				pthread_rwlock_unlock(&pMACS->m_rwlockBestSoFar);
+				pMACS->logSolution(pSnapshot);
 
 				// inform the main process
 				pthread_mutex_lock(&pMACS->m_mutexBetterSolution);
@@ -865,263 +862,1177 @@ void *VrptwMACS::acs_time(void *pArg)
 		if (pMACS->m_bStopRunning)
 			return NULL;
 
-		// read shared resource (read)
-		pthread_rwlock_rdlock(&pMACS->m_rwlockBestSoFar);
-		dDistance_bestsofar = pMACS->m_dDistance_bestsofar;
-		pthread_rwlock_unlock(&pMACS->m_rwlockBestSoFar);
-
-		if (bNoData == false)
+		// only acs_time publishes the best solution of the island
+		if (bNoData == false
+			&& dDistance_newbest < readSnapshot(&pIsland->pBest)->dDistance)
 		{
-			if (dDistance_newbest < dDistance_bestsofar)
-			{
-				// lock shared resource (write)
-				pthread_rwlock_wrlock(&pMACS->m_rwlockBestSoFar);
+			pSnapshot = pMACS->createSnapshot(iVehicleCount_bestsofar,
+											  dDistance_newbest,
+											  ppiTourMatrix_newbest);
 
-				if (iVehicleCount_bestsofar == pMACS->m_iVehicleCount_bestsofar)
-				{
-					pMACS->m_dDistance_bestsofar = dDistance_newbest;
-					CopyTourMatrix(iVehicleCount_bestsofar, iToursMaxSize,
-								   ppiTourMatrix_bestsofar, ppiTourMatrix_newbest);
-
-					// solution logger
-					if (pMACS->m_pSolutionLogger != NULL)
-					{
-						pMACS->m_pSolutionLogger->add(iVehicleCount_bestsofar,
-													  dDistance_newbest,
-													  ppiTourMatrix_newbest);
-					}
-				}
+			if (pSnapshot != NULL)
+			{
+				pMACS->publishSnapshot(&pIsland->pBest, pSnapshot);
 
-				// unlock shared resource (write)
-				pthread_rwlock_unlock(&pMACS->m_rwlockBestSoFar);
+				if (pMACS->m_bSynchronized)
+					pIsland->pFound_time = pSnapshot;
+				else if (pMACS->publishBestSoFar(pSnapshot))
+					pMACS->logSolution(pSnapshot);
 			}
 		}
 
-		// perform global updating
-		dTmp1 = 1.0-pMACS->m_dRho;
-		dTmp2 = pMACS->m_dRho/dDistance_bestsofar;
-
-		// lock shared resource (read)
-		pthread_rwlock_rdlock(&pMACS->m_rwlockBestSoFar);
-
-		iLastNode = ppiTourMatrix_bestsofar[0][iToursMaxSize];
-		iToursVehicleCount = pMACS->m_iVehicleCount_bestsofar;
-
-		for (i=0; i<iToursVehicleCount; i++)
+		if (pMACS->m_bSynchronized)
 		{
-			// from depot to customers
-			iCount = ppiTourMatrix_bestsofar[i][0];
+			if (pMACS->synchronize())
+				return NULL;
+		}
+		else
+		{
+			// exchange the best solutions with the neighbour islands
+			iIteration++;
 
-			for (j=1; j<=iCount; j++)
+			if (pMACS->m_iIslands > 1 && pMACS->m_iMigrationInterval > 0
+				&& iIteration % pMACS->m_iMigrationInterval == 0)
 			{
-				iNextNode = ppiTourMatrix_bestsofar[i][j];
-				ppdPheromoneMatrix[iLastNode][iNextNode] *= dTmp1;
-				ppdPheromoneMatrix[iLastNode][iNextNode] += dTmp2;
-				iLastNode = iNextNode;
+				pMACS->migrate(pIsland, iVehicleCount_bestsofar);
 			}
+		}
 
-			// back to depot
-			if (i < iToursVehicleCount-1)
-				iNextNode = ppiTourMatrix_bestsofar[i+1][iToursMaxSize];
-			else
-				iNextNode = ppiTourMatrix_bestsofar[0][iToursMaxSize];
+		// perform global updating
+		pBest = readSnapshot(&pIsland->pBest);
+		piArcs = pBest->piArcs;
 
-			ppdPheromoneMatrix[iLastNode][iNextNode] *= dTmp1;
-			ppdPheromoneMatrix[iLastNode][iNextNode] += dTmp2;
-			iLastNode = iNextNode;
-		}
+		dTmp1 = 1.0-pMACS->m_dRho;
+		dTmp2 = pMACS->m_dRho/pBest->dDistance;
 
-		// unlock shared resource
-		pthread_rwlock_unlock(&pMACS->m_rwlockBestSoFar);
+		for (i=0; i<pBest->iArcCount; i++)
+			pPheromone->update(piArcs[2*i], piArcs[2*i+1], dTmp1, dTmp2);
 	}
 	while (pMACS->m_bStopRunning == false);
 
 	return NULL;
 }
 
-bool VrptwMACS::new_active_ant(bool bVEI,
-							   int iNodes,
-							   double dTau0,
-							   int iMaxVehicleCount,
-							   int *piToursVehicleCount,
-							   double *pdToursDistance)
+// sends the best solution of the island to the next island and takes the
+// one of the previous island if it is better
+void VrptwMACS::migrate(ISLAND_t *pIsland,
+						int iVehicleCount)
 {
-	short nBeta;
-	int i, iCustomer, iCapacity, iMaxCapacity;
-	int iLastNode, iNextNode, iToursVehicleCount;
-	double dTime, dDistance, dToursDistance, dTemp, dEta, dProbabilitySum;
-	bool *pbNodesVisited;
-	double *pdProbability;
-	double **ppdDistanceMatrix;
-	double **ppdPheromoneMatrix;
-	int **ppiTourMatrix;
-	MTRand *pMTRand;
+	int iMigrantVehicleCount;
+	double dMigrantDistance;
+	ISLAND_t *pNextIsland;
+	SNAPSHOT_t *pBest, *pSnapshot;
 
-	// init vars
-	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+	pNextIsland = &m_pIslands[(pIsland->iIsland+1) % m_iIslands];
+	pBest = readSnapshot(&pIsland->pBest);
 
-	if (bVEI)
+	pNextIsland->Mailbox.post(pBest->iVehicleCount, pBest->dDistance,
+							  pBest->ppiTourMatrix);
+
+	if (pIsland->Mailbox.take(&iMigrantVehicleCount, &dMigrantDistance,
+							  pIsland->ppiTourMatrix_migrant_time) == false)
 	{
-		pMTRand = &m_MTRand_vei;
-		ppdPheromoneMatrix = m_ppdPheromoneMatrix_vei;
-		pbNodesVisited = m_pbNodesVisited_vei;
-		pdProbability = m_pdProbability_vei;
-		ppiTourMatrix = m_ppiTourMatrix_vei;
+		return;
 	}
-	else
+
+	if (iMigrantVehicleCount != iVehicleCount
+		|| dMigrantDistance >= pBest->dDistance)
 	{
-		pMTRand = &m_MTRand_time;
-		ppdPheromoneMatrix = m_ppdPheromoneMatrix_time;
-		pbNodesVisited = m_pbNodesVisited_time;
-		pdProbability = m_pdProbability_time;
-		ppiTourMatrix = m_ppiTourMatrix_time;
+		return;
 	}
 
-	for (i=0; i<iNodes; i++)
-		pbNodesVisited[i] = false;
+	pSnapshot = createSnapshot(iVehicleCount, dMigrantDistance,
+							   pIsland->ppiTourMatrix_migrant_time);
 
-	// put ant in a randomly selected duplicated depot
-	iLastNode = m_iCustomerCount + pMTRand->randInt(iMaxVehicleCount-1);
+	if (pSnapshot != NULL)
+		publishSnapshot(&pIsland->pBest, pSnapshot);
+}
 
-	// save start depot
-	ppiTourMatrix[0][m_iToursMaxSize] = iLastNode;
-	iCustomer = 0;
-	dTime = 0.0;
-	iCapacity = iMaxCapacity = m_pInstanceData->getCapacity();
+// end of an iteration in lockstep: the colonies wait for each other, the
+// last one exchanges the solutions. true = the colony has to stop
+bool VrptwMACS::synchronize()
+{
+	bool bStop;
+	unsigned int uMeeting;
 
-	iToursVehicleCount = 0;
-	dToursDistance = 0.0;
+	pthread_mutex_lock(&m_mutexColonies);
 
-	do
+	m_iColoniesArrived++;
+
+	if (m_iColoniesArrived == m_iColonies)
 	{
-		dProbabilitySum = 0.0;
+		exchangeSolutions();
 
-		for (i=0; i<iNodes; i++)
-		{
-			if (m_bStopRunning)
-				return false;
+		m_iColoniesArrived = 0;
+		m_uMeeting++;
+		pthread_cond_broadcast(&m_condColonies);
+	}
+	else
+	{
+		uMeeting = m_uMeeting;
 
-			pdProbability[i] = 0.0;
+		while (uMeeting == m_uMeeting)
+			pthread_cond_wait(&m_condColonies, &m_mutexColonies);
+	}
 
-			// is served?
-			if (pbNodesVisited[i] == true)
-				continue;
+	bStop = m_bStopRunning;
 
-			if (i < m_iCustomerCount) // customer
-			{
-				// check capacity
-				if (m_piCustomerDemand[i] > iCapacity)
-					continue;
+	pthread_mutex_unlock(&m_mutexColonies);
 
-				// check due date
-				if (iLastNode > m_iCustomerCount)
-					dDistance = ppdDistanceMatrix[m_iCustomerCount][i];
-				else
-					dDistance = ppdDistanceMatrix[iLastNode][i];
+	return bStop;
+}
 
-				dTemp = dTime + dDistance;
+// all colonies wait in synchronize(), so the solutions are published in
+// the order of the islands whichever thread runs this
+void VrptwMACS::exchangeSolutions()
+{
+	bool bStop;
+	int iIsland, iMigrantVehicleCount;
+	double dMigrantDistance;
+	ISLAND_t *pIsland;
+	SNAPSHOT_t *pSnapshot;
 
-				if (dTemp > m_piCustomerDueDate[i])
-					continue;
+	for (iIsland=0; iIsland<m_iIslands; iIsland++)
+	{
+		pIsland = &m_pIslands[iIsland];
 
-				// check depot due time
-				if (dTemp < m_piCustomerReadyTime[i])
-					dTemp = m_piCustomerReadyTime[i];
+		if (pIsland->pFound_vei != NULL && publishBestSoFar(pIsland->pFound_vei))
+			logSolution(pIsland->pFound_vei);
 
-				dTemp += m_piCustomerServiceTime[i];
-				dTemp += ppdDistanceMatrix[i][m_iCustomerCount];
+		if (pIsland->pFound_time != NULL && publishBestSoFar(pIsland->pFound_time))
+			logSolution(pIsland->pFound_time);
 
-				if (dTemp > m_iDepotDueDate)
-					continue;
+		pIsland->pFound_vei = NULL;
+		pIsland->pFound_time = NULL;
+	}
 
-				// calculate attractiveness
-				dTemp = __max(dTime + dDistance, m_piCustomerReadyTime[i]);
-				dTemp -= dTime;
-				dTemp *= (m_piCustomerDueDate[i]-dTime);
+	m_iIterations++;
+	m_iRounds++;
 
-				if (bVEI)
-					dTemp = __max(1.0, dTemp-m_piIN_vei[i]);
-				else
-					dTemp = __max(1.0, dTemp);
+	if (m_iMaxIterations > 0 && m_iIterations >= m_iMaxIterations)
+		IntAtomicStore(&m_iLimitReached, 1);
 
-				dEta = 1.0 / dTemp;
-			}
-			else // duplicated depot
-			{
-				if (iLastNode >= m_iCustomerCount)
-					continue;
+	bStop = m_pBestSoFar->iVehicleCount < m_iRestartVehicleCount
+		|| IntAtomicLoad(&m_iLimitReached) != 0;
 
-				dDistance = ppdDistanceMatrix[iLastNode][m_iCustomerCount];
+	if (bStop)
+	{
+		// inform the main process
+		pthread_mutex_lock(&m_mutexBetterSolution);
+		m_bStopRunning = true;
+		pthread_cond_signal(&m_condBetterSolution);
+		pthread_mutex_unlock(&m_mutexBetterSolution);
+		return;
+	}
 
-				// calculate attractiveness
-				dEta = 1.0;
-				dEta /= dDistance * (m_iDepotDueDate-dTime);
-			}
+	// pass the best solutions of the islands on in the ring
+	if (m_iIslands < 2 || m_iMigrationInterval == 0
+		|| m_iRounds % m_iMigrationInterval != 0)
+	{
+		return;
+	}
 
-			pdProbability[i] = ppdPheromoneMatrix[iLastNode][i];
+	for (iIsland=0; iIsland<m_iIslands; iIsland++)
+	{
+		pIsland = &m_pIslands[iIsland];
+		pSnapshot = readSnapshot(&pIsland->pBest);
 
-			for (nBeta=0; nBeta<m_nBeta; nBeta++)
-				pdProbability[i] *= dEta;
+		m_pIslands[(iIsland+1) % m_iIslands].Mailbox.post(
+			pSnapshot->iVehicleCount, pSnapshot->dDistance,
+			pSnapshot->ppiTourMatrix);
+	}
 
-			dProbabilitySum += pdProbability[i];
-		}
+	for (iIsland=0; iIsland<m_iIslands; iIsland++)
+	{
+		pIsland = &m_pIslands[iIsland];
+		pSnapshot = readSnapshot(&pIsland->pBest);
 
-		// exploitation or exploration?
-		do
+		if (pIsland->Mailbox.take(&iMigrantVehicleCount, &dMigrantDistance,
+								  pIsland->ppiTourMatrix_migrant_time) == false
+			|| iMigrantVehicleCount != m_iRestartVehicleCount
+			|| dMigrantDistance >= pSnapshot->dDistance)
 		{
-			// exploitation
-			if (m_dQ0 > 0.0)
+			continue;
+		}
+
+		pSnapshot = createSnapshot(iMigrantVehicleCount, dMigrantDistance,
+								   pIsland->ppiTourMatrix_migrant_time);
+
+		if (pSnapshot != NULL)
+			publishSnapshot(&pIsland->pBest, pSnapshot);
+	}
+}
+
+// seed of the random numbers of an ant, every island, colony and ant gets
+// its own stream (splitmix32 finalizer)
+unsigned int VrptwMACS::deriveSeed(unsigned int uSeed,
+								   int iIsland,
+								   bool bVEI,
+								   int iAnt)
+{
+	unsigned int uHash;
+
+	uHash = uSeed;
+	uHash += 0x9e3779b9u * (unsigned int)(2*iIsland + (bVEI ? 0 : 1) + 1);
+	uHash += 0x85ebca6bu * (unsigned int)(iAnt + 1);
+
+	uHash ^= uHash >> 16;
+	uHash *= 0x7feb352du;
+	uHash ^= uHash >> 15;
+	uHash *= 0x846ca68bu;
+	uHash ^= uHash >> 16;
+
+	return uHash;
+}
+
+// solution and the arcs of its routes in one block
+VrptwMACS::SNAPSHOT_t *VrptwMACS::createSnapshot(int iVehicleCount,
+												 double dDistance,
+												 int **ppiTourMatrix)
+{
+	int i, j, iCount, iArcCount, iLastNode;
+	int *piRow, *piArcs;
+	SNAPSHOT_t *pSnapshot;
+
+	iArcCount = 0;
+
+	for (i=0; i<iVehicleCount; i++)
+		iArcCount += ppiTourMatrix[i][0]+1;
+
+	pSnapshot = (SNAPSHOT_t*)malloc(sizeof(SNAPSHOT_t)
+		+ sizeof(int *) * iVehicleCount
+		+ sizeof(int) * iVehicleCount * (m_iToursMaxSize+1)
+		+ sizeof(int) * 2 * iArcCount);
+
+	if (pSnapshot == NULL)
+		return NULL;
+
+	pSnapshot->iRefCount = 0;
+	pSnapshot->iVehicleCount = iVehicleCount;
+	pSnapshot->dDistance = dDistance;
+	pSnapshot->ppiTourMatrix = (int **)(pSnapshot+1);
+	pSnapshot->iArcCount = iArcCount;
+	pSnapshot->uRetireEpoch = 0;
+	pSnapshot->pNextRetired = NULL;
+
+	piRow = (int *)(pSnapshot->ppiTourMatrix + iVehicleCount);
+
+	for (i=0; i<iVehicleCount; i++)
+	{
+		pSnapshot->ppiTourMatrix[i] = piRow;
+		piRow += m_iToursMaxSize+1;
+	}
+
+	CopyTourMatrix(iVehicleCount, m_iToursMaxSize, pSnapshot->ppiTourMatrix,
+				   ppiTourMatrix);
+
+	// from the depot to the customers and back
+	piArcs = piRow;
+	pSnapshot->piArcs = piArcs;
+
+	for (i=0; i<iVehicleCount; i++)
+	{
+		iLastNode = m_iCustomerCount;
+		iCount = ppiTourMatrix[i][0];
+
+		for (j=1; j<=iCount; j++)
+		{
+			*piArcs++ = iLastNode;
+			*piArcs++ = iLastNode = ppiTourMatrix[i][j];
+		}
+
+		*piArcs++ = iLastNode;
+		*piArcs++ = m_iCustomerCount;
+	}
+
+	return pSnapshot;
+}
+
+// replaces the snapshot of a slot, readers see the old or the new one
+void VrptwMACS::publishSnapshot(SNAPSHOT_t **ppSlot,
+								SNAPSHOT_t *pSnapshot)
+{
+	SNAPSHOT_t *pOld;
+
+	IntAtomicAdd(&pSnapshot->iRefCount, 1);
+	pOld = (SNAPSHOT_t*)PtrAtomicExchange((void**)ppSlot, pSnapshot);
+	releaseSnapshot(pOld);
+}
+
+// publishes the snapshot as best solution so far if it has fewer vehicles
+// or the same vehicles and a lower distance
+bool VrptwMACS::publishBestSoFar(SNAPSHOT_t *pSnapshot)
+{
+	SNAPSHOT_t *pOld, *pSeen;
+
+	IntAtomicAdd(&pSnapshot->iRefCount, 1);
+	pSeen = (SNAPSHOT_t*)PtrAtomicLoad((void**)&m_pBestSoFar);
+
+	do
+	{
+		pOld = pSeen;
+
+		if (pSnapshot->iVehicleCount > pOld->iVehicleCount
+			|| (pSnapshot->iVehicleCount == pOld->iVehicleCount
+				&& pSnapshot->dDistance >= pOld->dDistance))
+		{
+			releaseSnapshot(pSnapshot);
+			return false;
+		}
+
+		pSeen = (SNAPSHOT_t*)PtrAtomicCompareExchange((void**)&m_pBestSoFar,
+													  pOld, pSnapshot);
+	}
+	while (pSeen != pOld);
+
+	releaseSnapshot(pOld);
+
+	return true;
+}
+
+// a snapshot without references is retired, it is freed by
+// reclaimSnapshots() or freeRetiredSnapshots()
+void VrptwMACS::releaseSnapshot(SNAPSHOT_t *pSnapshot)
+{
+	if (pSnapshot == NULL
+		|| IntAtomicAdd(&pSnapshot->iRefCount, -1) != 0)
+	{
+		return;
+	}
+
+	pSnapshot->uRetireEpoch = UIntAtomicAdd(&m_uSnapshotEpoch, 1) - 1;
+	pushRetiredSnapshot(pSnapshot);
+}
+
+// adds the snapshot to the retired list
+void VrptwMACS::pushRetiredSnapshot(SNAPSHOT_t *pSnapshot)
+{
+	SNAPSHOT_t *pSeen;
+
+	pSeen = (SNAPSHOT_t*)PtrAtomicLoad((void**)&m_pRetiredSnapshots);
+
+	do
+	{
+		pSnapshot->pNextRetired = pSeen;
+		pSeen = (SNAPSHOT_t*)PtrAtomicCompareExchange(
+			(void**)&m_pRetiredSnapshots, pSnapshot->pNextRetired, pSnapshot);
+	}
+	while (pSeen != pSnapshot->pNextRetired);
+}
+
+// frees the retired snapshots every colony may no longer read, only
+// called by acs_time of the first island
+void VrptwMACS::reclaimSnapshots()
+{
+	int iIsland;
+	unsigned int uEpoch, uMinEpoch;
+	SNAPSHOT_t *pSnapshot, *pNext;
+
+	pSnapshot = (SNAPSHOT_t*)PtrAtomicExchange((void**)&m_pRetiredSnapshots,
+											   NULL);
+
+	if (pSnapshot == NULL)
+		return;
+
+	uMinEpoch = UINT_MAX;
+
+	for (iIsland=0; iIsland<m_iIslands; iIsland++)
+	{
+		uEpoch = UIntAtomicLoad(&m_pIslands[iIsland].uEpoch_vei);
+
+		if (uEpoch < uMinEpoch)
+			uMinEpoch = uEpoch;
+
+		uEpoch = UIntAtomicLoad(&m_pIslands[iIsland].uEpoch_time);
+
+		if (uEpoch < uMinEpoch)
+			uMinEpoch = uEpoch;
+	}
+
+	for (; pSnapshot!=NULL; pSnapshot=pNext)
+	{
+		pNext = pSnapshot->pNextRetired;
+
+		if (pSnapshot->uRetireEpoch < uMinEpoch)
+		{
+			free(pSnapshot);
+			continue;
+		}
+
+		// still visible to a colony
+		pushRetiredSnapshot(pSnapshot);
+	}
+}
+
+// only called while the colonies are stopped
+void VrptwMACS::freeRetiredSnapshots()
+{
+	SNAPSHOT_t *pSnapshot, *pNext;
+
+	pSnapshot = m_pRetiredSnapshots;
+	m_pRetiredSnapshots = NULL;
+
+	for (; pSnapshot!=NULL; pSnapshot=pNext)
+	{
+		pNext = pSnapshot->pNextRetired;
+		free(pSnapshot);
+	}
+}
+
+void VrptwMACS::logSolution(SNAPSHOT_t *pSnapshot)
+{
+	if (m_pSolutionLogger == NULL)
+		return;
+
+	pthread_mutex_lock(&m_mutexSolutionLogger);
+	m_pSolutionLogger->add(pSnapshot->iVehicleCount, pSnapshot->dDistance,
+						   pSnapshot->ppiTourMatrix);
+	pthread_mutex_unlock(&m_mutexSolutionLogger);
+}
+
+// k nearest customers of every customer and of the depot, no lists if the
+// rule would score (nearly) all customers anyway
+int VrptwMACS::createCandidateLists()
+{
+	int i, j, iRow, iLength, iFill;
+	double dDistance;
+	double *pdRow;
+	int *piList;
+
+	m_iCandidateListLength = 0;
+
+	if (m_iCandidateListSize == 0 || m_iCandidateListSize >= m_iCustomerCount-1)
+		return 0;
+
+	iLength = m_iCandidateListSize;
+
+	m_ppiCandidateList = generate_int_matrix(m_iCustomerCount+1, iLength);
+
+	if (m_ppiCandidateList == NULL)
+		return -1;
+
+	for (iRow=0; iRow<=m_iCustomerCount; iRow++)
+	{
+		pdRow = m_pInstanceData->getDistanceMatrix()[iRow];
+		piList = m_ppiCandidateList[iRow];
+		iFill = 0;
+
+		// insertion selection, ties keep the lower index
+		for (i=0; i<m_iCustomerCount; i++)
+		{
+			if (i == iRow)
+				continue;
+
+			dDistance = pdRow[i];
+
+			if (iFill == iLength)
 			{
-				// exploitation
-				if (pMTRand->rand() < m_dQ0)
-				{
-					dTemp = 0.0;
+				if (dDistance >= pdRow[piList[iLength-1]])
+					continue;
 
-					for (i=0; i<iNodes; i++)
-					{
-						if (pdProbability[i] > dTemp)
-						{
-							dTemp = pdProbability[i];
-							iNextNode = i;
-						}
-					}
+				iFill--;
+			}
 
-					break;
-				}
+			for (j=iFill; j>0 && pdRow[piList[j-1]] > dDistance; j--)
+				piList[j] = piList[j-1];
+
+			piList[j] = i;
+			iFill++;
+		}
+	}
+
+	m_iCandidateListLength = iLength;
+
+	return 0;
+}
+
+// the pheromone, the ants and the best solution of an island
+int VrptwMACS::createIsland(ISLAND_t *pIsland,
+							int iIsland,
+							int iVehicleCount,
+							bool bSparse)
+{
+	int iMatrixSize, iLocalSearchThreads;
+
+	pIsland->pMACS = this;
+	pIsland->iIsland = iIsland;
+	pIsland->pPools = &m_pIslandPools[iIsland];
+	pIsland->pBest = NULL;
+	pIsland->uEpoch_vei = UINT_MAX;
+	pIsland->uEpoch_time = UINT_MAX;
+	pIsland->pFound_vei = NULL;
+	pIsland->pFound_time = NULL;
+	pIsland->piIN_vei = NULL;
+	pIsland->ppiTourMatrix_acsvei = NULL;
+	pIsland->pAnts_vei = NULL;
+	pIsland->ppiTourMatrix_newbest_time = NULL;
+	pIsland->ppiTourMatrix_migrant_time = NULL;
+	pIsland->pAnts_time = NULL;
+
+	iMatrixSize = ScratchArena::getAllocSize(sizeof(int) * iVehicleCount
+		* (m_iToursMaxSize+1) + sizeof(int *) * iVehicleCount);
+
+	if (pIsland->Arena.create(ScratchArena::getAllocSize(sizeof(int)
+			* m_iCustomerCount) + 3*iMatrixSize) != 0)
+	{
+		return -1;
+	}
+
+	pIsland->piIN_vei = (int*)pIsland->Arena.alloc(sizeof(int)*m_iCustomerCount);
+
+	pIsland->ppiTourMatrix_acsvei = pIsland->Arena.allocIntMatrix(iVehicleCount,
+		m_iToursMaxSize+1);
+
+	pIsland->ppiTourMatrix_newbest_time = pIsland->Arena.allocIntMatrix(
+		iVehicleCount, m_iToursMaxSize+1);
+
+	pIsland->ppiTourMatrix_migrant_time = pIsland->Arena.allocIntMatrix(
+		iVehicleCount, m_iToursMaxSize+1);
+
+	if (pIsland->piIN_vei == NULL
+		|| pIsland->ppiTourMatrix_acsvei == NULL
+		|| pIsland->ppiTourMatrix_newbest_time == NULL
+		|| pIsland->ppiTourMatrix_migrant_time == NULL
+		|| pIsland->Mailbox.create(iVehicleCount, m_iToursMaxSize) != 0
+		|| pIsland->Pheromone_vei.create(m_iCustomerCount+1, bSparse) != 0
+		|| pIsland->Pheromone_time.create(m_iCustomerCount+1, bSparse) != 0
+		|| createAnts(pIsland, true, iVehicleCount, &pIsland->pAnts_vei) != 0
+		|| createAnts(pIsland, false, iVehicleCount, &pIsland->pAnts_time) != 0)
+	{
+		return -1;
+	}
+
+	// the islands search at the same time, each one has its own local
+	// search pool if its ants run one after the other
+	iLocalSearchThreads = (m_iAntThreads == 0 && m_iLocalSearchThreads > 1)
+		? m_iLocalSearchThreads : 0;
+
+	if (resizePool(&pIsland->pPools->AntPool_vei, m_iAntThreads) != 0
+		|| resizePool(&pIsland->pPools->AntPool_time, m_iAntThreads) != 0
+		|| resizePool(&pIsland->pPools->LocalSearchPool_time,
+					  iLocalSearchThreads) != 0)
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+// the threads of the island pools are left running for the next run
+void VrptwMACS::freeIsland(ISLAND_t *pIsland)
+{
+	freeAnts(&pIsland->pAnts_vei);
+	freeAnts(&pIsland->pAnts_time);
+
+	pIsland->Pheromone_vei.destroy();
+	pIsland->Pheromone_time.destroy();
+	pIsland->Mailbox.destroy();
+
+	pIsland->piIN_vei = NULL;
+	releaseSnapshot(pIsland->pBest);
+	pIsland->pBest = NULL;
+	pIsland->ppiTourMatrix_acsvei = NULL;
+	pIsland->ppiTourMatrix_newbest_time = NULL;
+	pIsland->ppiTourMatrix_migrant_time = NULL;
+	pIsland->Arena.destroy();
+}
+
+// (re)starts a pool unless it runs with iThreadCount threads already,
+// 0 stops it
+int VrptwMACS::resizePool(WorkerPool *pPool,
+						  int iThreadCount)
+{
+	if (pPool->getThreadCount() == iThreadCount)
+		return 0;
+
+	if (iThreadCount == 0)
+	{
+		pPool->stop();
+		return 0;
+	}
+
+	return pPool->start(iThreadCount);
+}
+
+// one ant per colony if they run one after the other, else m_iAntsCount ants
+// which record their local updates
+int VrptwMACS::createAnts(ISLAND_t *pIsland,
+						  bool bVEI,
+						  int iVehicleCount,
+						  ANT_t **ppAnts)
+{
+	int i, iCount, iMaxNodes, iArenaSize;
+	ANT_t *pAnt, *pAnts;
+
+	iCount = m_iAntThreads > 0 ? m_iAntsCount : 1;
+	iMaxNodes = m_iCustomerCount+1;
+
+	pAnts = new ANT_t[iCount];
+	*ppAnts = pAnts;
+
+	for (i=0; i<iCount; i++)
+	{
+		pAnts[i].LSState.pbRouteDirty[0] = NULL;
+		pAnts[i].LSState.pbRouteChanged = NULL;
+		pAnts[i].LSState.pbDontLook = NULL;
+	}
+
+	// init random number generator, the first ant seeds the others
+	if (m_uSeed != 0)
+		pAnts[0].Random.seed(deriveSeed(m_uSeed, pIsland->iIsland, bVEI, 0));
+	else
+	{
+#ifdef _DEBUG
+		// everytime the same random numbers
+		if (bVEI)
+			pAnts[0].Random.seed(1805017555 + pIsland->iIsland);
+		else
+			pAnts[0].Random.seed(555180501 + pIsland->iIsland);
+#else
+		pAnts[0].Random.seed();
+#endif
+	}
+
+	iArenaSize = ScratchArena::getAllocSize(sizeof(unsigned int)
+			* BITSET_WORDS(iMaxNodes))
+		+ ScratchArena::getAllocSize(sizeof(double)*iMaxNodes)
+		+ ScratchArena::getAllocSize(sizeof(int)*iMaxNodes)
+		+ ScratchArena::getAllocSize(sizeof(float)*iMaxNodes)
+		+ ScratchArena::getAllocSize(sizeof(int)*(m_iCustomerCount+1))
+		+ ScratchArena::getAllocSize(sizeof(double)*(m_iCustomerCount+1))
+		+ ScratchArena::getAllocSize(sizeof(int) * iVehicleCount
+			* (m_iToursMaxSize+1) + sizeof(int *) * iVehicleCount);
+
+	// every step adds one arc, the depot is left once per vehicle
+	if (m_iAntThreads > 0)
+	{
+		iArenaSize += ScratchArena::getAllocSize(sizeof(int) * 2
+			* (m_iCustomerCount+iVehicleCount+1));
+	}
+
+	// the local search of acs_time uses the rest of the arena
+	if (bVEI == false)
+		iArenaSize += getLocalSearchScratchSize(iVehicleCount);
+
+	for (i=0; i<iCount; i++)
+	{
+		pAnt = &pAnts[i];
+
+		pAnt->bVEI = bVEI;
+		pAnt->pPheromone = bVEI ? &pIsland->Pheromone_vei : &pIsland->Pheromone_time;
+		pAnt->piIN = bVEI ? pIsland->piIN_vei : NULL;
+		pAnt->bFeasible = false;
+		pAnt->iToursVehicleCount = 0;
+		pAnt->dToursDistance = 0.0;
+		pAnt->iArcCount = 0;
+
+		if (i > 0 && m_uSeed != 0)
+			pAnt->Random.seed(deriveSeed(m_uSeed, pIsland->iIsland, bVEI, i));
+		else if (i > 0)
+			pAnt->Random.seed(pAnts[0].Random.randInt());
+
+		if (pAnt->Arena.create(iArenaSize) != 0)
+			return -1;
+
+		pAnt->puNodesVisited = (unsigned int*)pAnt->Arena.alloc(
+			sizeof(unsigned int)*BITSET_WORDS(iMaxNodes));
+
+		pAnt->pdProbability = (double*)pAnt->Arena.alloc(sizeof(double)*iMaxNodes);
+
+		pAnt->piCandidates = (int*)pAnt->Arena.alloc(sizeof(int)*iMaxNodes);
+
+		pAnt->pfPheromoneRow = (float*)pAnt->Arena.alloc(sizeof(float)*iMaxNodes);
+
+		pAnt->ppiTourMatrix = pAnt->Arena.allocIntMatrix(iVehicleCount,
+														 m_iToursMaxSize+1);
+
+		pAnt->piCustomersToVisit = (int*)pAnt->Arena.alloc(sizeof(int)
+			* (m_iCustomerCount+1));
+
+		pAnt->pdLatestArrivals = (double*)pAnt->Arena.alloc(sizeof(double)
+			* (m_iCustomerCount+1));
+
+		pAnt->piArcs = NULL;
+
+		if (m_iAntThreads > 0)
+		{
+			pAnt->piArcs = (int*)pAnt->Arena.alloc(sizeof(int) * 2
+				* (m_iCustomerCount+iVehicleCount+1));
+
+			if (pAnt->piArcs == NULL)
+				return -1;
+		}
+
+		if (pAnt->puNodesVisited == NULL
+			|| pAnt->pdProbability == NULL
+			|| pAnt->piCandidates == NULL
+			|| pAnt->pfPheromoneRow == NULL
+			|| pAnt->ppiTourMatrix == NULL
+			|| pAnt->piCustomersToVisit == NULL
+			|| pAnt->pdLatestArrivals == NULL
+			|| pAnt->Index.create(m_iCustomerCount, iVehicleCount) != 0)
+		{
+			return -1;
+		}
+
+		if (bVEI)
+			continue;
+
+		// the local search runs single threaded beside other ants
+		if (createLocalSearchState(iVehicleCount, &pAnt->LSState) != 0)
+			return -1;
+
+		pAnt->LSState.pArena = &pAnt->Arena;
+		pAnt->LSState.bSingleThread = (m_iAntThreads > 0);
+		pAnt->LSState.pPool = &pIsland->pPools->LocalSearchPool_time;
+	}
+
+	return 0;
+}
+
+void VrptwMACS::freeAnts(ANT_t **ppAnts)
+{
+	int i, iCount;
+
+	if (*ppAnts == NULL)
+		return;
+
+	iCount = m_iAntThreads > 0 ? m_iAntsCount : 1;
+
+	for (i=0; i<iCount; i++)
+		freeLocalSearchState(&(*ppAnts)[i].LSState);
+
+	delete [] *ppAnts;
+	*ppAnts = NULL;
+}
+
+// pheromone * eta^beta of moving to iNode, 0.0 if iNode is not allowed
+double VrptwMACS::calcTransitionValue(ANT_t *pAnt,
+									  int iNode,
+									  int iLastNode,
+									  double dTime,
+									  int iCapacity)
+{
+	short nBeta;
+	double dDistance, dTemp, dEta, dValue;
+	double **ppdDistanceMatrix;
+
+	// is served?
+	if (BITSET_TEST(pAnt->puNodesVisited, iNode))
+		return 0.0;
+
+	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+
+	if (iNode < m_iCustomerCount) // customer
+	{
+		// check capacity
+		if (m_piCustomerDemand[iNode] > iCapacity)
+			return 0.0;
+
+		// check due date
+		dDistance = ppdDistanceMatrix[iLastNode][iNode];
+
+		dTemp = dTime + dDistance;
+
+		if (dTemp > m_piCustomerDueDate[iNode])
+			return 0.0;
+
+		// check depot due time
+		if (dTemp < m_piCustomerReadyTime[iNode])
+			dTemp = m_piCustomerReadyTime[iNode];
+
+		dTemp += m_piCustomerServiceTime[iNode];
+		dTemp += ppdDistanceMatrix[iNode][m_iCustomerCount];
+
+		if (dTemp > m_iDepotDueDate)
+			return 0.0;
+
+		// calculate attractiveness
+		dTemp = __max(dTime + dDistance, m_piCustomerReadyTime[iNode]);
+		dTemp -= dTime;
+		dTemp *= (m_piCustomerDueDate[iNode]-dTime);
+
+		if (pAnt->bVEI)
+			dTemp = __max(1.0, dTemp-pAnt->piIN[iNode]);
+		else
+			dTemp = __max(1.0, dTemp);
+
+		dEta = 1.0 / dTemp;
+	}
+	else // depot
+	{
+		if (iLastNode == m_iCustomerCount)
+			return 0.0;
+
+		dDistance = ppdDistanceMatrix[iLastNode][m_iCustomerCount];
+
+		// calculate attractiveness
+		dEta = 1.0;
+		dEta /= dDistance * (m_iDepotDueDate-dTime);
+	}
+
+	dValue = pAnt->pPheromone->get(iLastNode, iNode);
+
+	for (nBeta=0; nBeta<m_nBeta; nBeta++)
+		dValue *= dEta;
+
+	return dValue;
+}
+
+// feasible nodes are collected with the prefix sums of their values, an
+// exploitation step only keeps the first node of maximal value
+void VrptwMACS::addTransitionValue(bool bExploit,
+								   int iNode,
+								   double dValue,
+								   int *piCandidates,
+								   double *pdProbability,
+								   ANT_STEP_t *pStep)
+{
+	if (dValue <= 0.0)
+		return;
+
+	if (bExploit)
+	{
+		if (dValue > pStep->dBestValue)
+		{
+			pStep->dBestValue = dValue;
+			pStep->iBestNode = iNode;
+		}
+	}
+	else
+	{
+		pStep->dSum += dValue;
+		piCandidates[pStep->iCount] = iNode;
+		pdProbability[pStep->iCount] = pStep->dSum;
+	}
+
+	pStep->iCount++;
+}
+
+// one pass over all customers, four at a time with AVX2
+void VrptwMACS::scoreCustomers(ANT_t *pAnt,
+							   bool bExploit,
+							   int iLastNode,
+							   double dTime,
+							   int iCapacity,
+							   ANT_STEP_t *pStep)
+{
+	int i;
+#ifdef __AVX2__
+	int k, iMask, iVisited;
+	unsigned int *puNodesVisited;
+	short nBeta;
+	double pdValue[4];
+	double *pdDistanceRow, *pdDepotRow;
+	const float *pfPheromoneRow;
+	__m256d vTime, vOne, vCapacity, vDepotDueDate, vReadyTime, vDueDate;
+	__m256d vArrival, vStart, vTemp, vEta, vValue;
+#endif
+
+	i = 0;
+
+#ifdef __AVX2__
+	puNodesVisited = pAnt->puNodesVisited;
+	pdDistanceRow = m_pInstanceData->getDistanceMatrix()[iLastNode];
+
+	pdDepotRow = m_pInstanceData->getDistanceMatrix()[m_iCustomerCount];
+	pfPheromoneRow = pAnt->pPheromone->getRow(iLastNode, pAnt->pfPheromoneRow);
+
+	vTime = _mm256_set1_pd(dTime);
+	vOne = _mm256_set1_pd(1.0);
+	vCapacity = _mm256_set1_pd(iCapacity);
+	vDepotDueDate = _mm256_set1_pd(m_iDepotDueDate);
+
+	for (; i+3 < m_iCustomerCount; i+=4)
+	{
+		// i is a multiple of 4, the lanes share one bit set word
+		iVisited = (puNodesVisited[i >> 5] >> (i & 31)) & 0xF;
+
+		if (iVisited == 0xF)
+			continue;
+
+		vReadyTime = _mm256_cvtepi32_pd(
+			_mm_loadu_si128((const __m128i *)(m_piCustomerReadyTime+i)));
+		vDueDate = _mm256_cvtepi32_pd(
+			_mm_loadu_si128((const __m128i *)(m_piCustomerDueDate+i)));
+
+		// capacity, due date and depot due date
+		vArrival = _mm256_add_pd(vTime, _mm256_loadu_pd(pdDistanceRow+i));
+		vStart = _mm256_max_pd(vArrival, vReadyTime);
+
+		vTemp = _mm256_add_pd(vStart, _mm256_cvtepi32_pd(
+			_mm_loadu_si128((const __m128i *)(m_piCustomerServiceTime+i))));
+		vTemp = _mm256_add_pd(vTemp, _mm256_loadu_pd(pdDepotRow+i));
+
+		iMask = _mm256_movemask_pd(_mm256_and_pd(_mm256_and_pd(
+			_mm256_cmp_pd(_mm256_cvtepi32_pd(
+				_mm_loadu_si128((const __m128i *)(m_piCustomerDemand+i))),
+				vCapacity, _CMP_LE_OQ),
+			_mm256_cmp_pd(vArrival, vDueDate, _CMP_LE_OQ)),
+			_mm256_cmp_pd(vTemp, vDepotDueDate, _CMP_LE_OQ)));
+
+		iMask &= ~iVisited;
+
+		if (iMask == 0)
+			continue;
+
+		// attractiveness
+		vTemp = _mm256_mul_pd(_mm256_sub_pd(vStart, vTime),
+							  _mm256_sub_pd(vDueDate, vTime));
+
+		if (pAnt->bVEI)
+		{
+			vTemp = _mm256_sub_pd(vTemp, _mm256_cvtepi32_pd(
+				_mm_loadu_si128((const __m128i *)(pAnt->piIN+i))));
+		}
+
+		vEta = _mm256_div_pd(vOne, _mm256_max_pd(vTemp, vOne));
+
+		vValue = _mm256_cvtps_pd(_mm_loadu_ps(pfPheromoneRow+i));
+
+		for (nBeta=0; nBeta<m_nBeta; nBeta++)
+			vValue = _mm256_mul_pd(vValue, vEta);
+
+		_mm256_storeu_pd(pdValue, vValue);
+
+		for (k=0; k<4; k++)
+		{
+			if (iMask & (1 << k))
+			{
+				addTransitionValue(bExploit, i+k, pdValue[k], pAnt->piCandidates,
+								   pAnt->pdProbability, pStep);
 			}
+		}
+	}
+#endif
 
-			// exploration
-			dTemp = pMTRand->rand() * dProbabilitySum;
+	for (; i<m_iCustomerCount; i++)
+	{
+		addTransitionValue(bExploit, i,
+						   calcTransitionValue(pAnt, i, iLastNode, dTime, iCapacity),
+						   pAnt->piCandidates, pAnt->pdProbability, pStep);
+	}
+}
 
-			iNextNode = 0;
-			dProbabilitySum = pdProbability[0];
+// runs the ants of a colony on its pool, their local updates are applied
+// afterwards in the order of the ants
+void VrptwMACS::construct_ants(ISLAND_t *pIsland,
+							   bool bVEI,
+							   double dTau0,
+							   int iMaxVehicleCount)
+{
+	int i, iAnt;
+	int *piArcs;
+	PheromoneTable *pPheromone;
+	WorkerPool *pPool;
+	ANT_t *pAnts;
+	ANT_JOB_t Job;
 
-			while (dProbabilitySum < dTemp)
-				dProbabilitySum += pdProbability[++iNextNode];
+	if (bVEI)
+	{
+		pPheromone = &pIsland->Pheromone_vei;
+		pPool = &pIsland->pPools->AntPool_vei;
+		pAnts = pIsland->pAnts_vei;
+	}
+	else
+	{
+		pPheromone = &pIsland->Pheromone_time;
+		pPool = &pIsland->pPools->AntPool_time;
+		pAnts = pIsland->pAnts_time;
+	}
+
+	Job.pMACS = this;
+	Job.pAnts = pAnts;
+	Job.dTau0 = dTau0;
+	Job.iMaxVehicleCount = iMaxVehicleCount;
+
+	pPool->run(m_iAntsCount, construct_ant_job, (void*)&Job);
 
-			if (dTemp == 0.0)
+	// local pheromone update
+	for (iAnt=0; iAnt<m_iAntsCount; iAnt++)
+	{
+		piArcs = pAnts[iAnt].piArcs;
+
+		for (i=0; i<pAnts[iAnt].iArcCount; i++)
+			pPheromone->update(piArcs[2*i], piArcs[2*i+1], 1.0-m_dXi, m_dXi*dTau0);
+	}
+}
+
+void VrptwMACS::construct_ant_job(void *pArg,
+								  int iJob,
+								  int iThread)
+{
+	ANT_JOB_t *pJob;
+
+	pJob = (ANT_JOB_t *)pArg;
+
+	pJob->pMACS->new_active_ant(&pJob->pAnts[iJob], pJob->dTau0,
+								pJob->iMaxVehicleCount);
+}
+
+// constructs one solution, the result is kept in the ant
+bool VrptwMACS::new_active_ant(ANT_t *pAnt,
+							   double dTau0,
+							   int iMaxVehicleCount)
+{
+	bool bVEI, bExploit;
+	int i, iCustomer, iCustomersLeft, iCapacity, iMaxCapacity;
+	int j, iLastNode, iNextNode, iToursVehicleCount, iMid, iHigh;
+	double dTime, dDistance, dToursDistance, dTemp;
+	unsigned int *puNodesVisited;
+	double *pdProbability;
+	int *piCandidates;
+	int *piCandidateList;
+	double **ppdDistanceMatrix;
+	PheromoneTable *pPheromone;
+	int **ppiTourMatrix;
+	AntRandom *pRandom;
+	ANT_STEP_t Step;
+
+	// init vars
+	ppdDistanceMatrix = m_pInstanceData->getDistanceMatrix();
+
+	bVEI = pAnt->bVEI;
+	pRandom = &pAnt->Random;
+	pPheromone = pAnt->pPheromone;
+	puNodesVisited = pAnt->puNodesVisited;
+	pdProbability = pAnt->pdProbability;
+	piCandidates = pAnt->piCandidates;
+	ppiTourMatrix = pAnt->ppiTourMatrix;
+
+	pAnt->bFeasible = false;
+	pAnt->iToursVehicleCount = 0;
+	pAnt->dToursDistance = 0.0;
+	pAnt->iArcCount = 0;
+
+	memset(puNodesVisited, 0,
+		   sizeof(unsigned int)*BITSET_WORDS(m_iCustomerCount+1));
+
+	// put ant in the depot, the depot of route r is numbered n+r in the
+	// tour matrix only
+	iLastNode = m_iCustomerCount;
+
+	ppiTourMatrix[0][m_iToursMaxSize] = m_iCustomerCount;
+	iCustomer = 0;
+	iCustomersLeft = m_iCustomerCount;
+	dTime = 0.0;
+	iCapacity = iMaxCapacity = m_pInstanceData->getCapacity();
+
+	iToursVehicleCount = 0;
+	dToursDistance = 0.0;
+
+	do
+	{
+		// draw first, exploitation needs neither the list nor the sum
+		bExploit = false;
+
+		if (m_dQ0 > 0.0)
+			bExploit = (pRandom->rand() < m_dQ0);
+
+		Step.iCount = 0;
+		Step.iBestNode = -1;
+		Step.dBestValue = 0.0;
+		Step.dSum = 0.0;
+
+		// choose among the nearest unvisited customers and the depot
+		if (m_iCandidateListLength != 0)
+		{
+			piCandidateList = m_ppiCandidateList[iLastNode];
+
+			for (j=0; j<m_iCandidateListLength; j++)
 			{
-				while (dProbabilitySum < 0.0)
-					dProbabilitySum += pdProbability[++iNextNode];
+				i = piCandidateList[j];
+
+				addTransitionValue(bExploit, i,
+								   calcTransitionValue(pAnt, i, iLastNode, dTime,
+													   iCapacity),
+								   piCandidates, pdProbability, &Step);
+			}
+
+			if (iLastNode != m_iCustomerCount)
+			{
+				addTransitionValue(bExploit, m_iCustomerCount,
+								   calcTransitionValue(pAnt, m_iCustomerCount,
+													   iLastNode, dTime, iCapacity),
+								   piCandidates, pdProbability, &Step);
+			}
+		}
+
+		// no candidate feasible, scan all nodes
+		if (Step.iCount == 0)
+		{
+			scoreCustomers(pAnt, bExploit, iLastNode, dTime, iCapacity, &Step);
+
+			// back to the depot, if not scored as a candidate already
+			if (iLastNode != m_iCustomerCount && m_iCandidateListLength == 0)
+			{
+				addTransitionValue(bExploit, m_iCustomerCount,
+								   calcTransitionValue(pAnt, m_iCustomerCount,
+													   iLastNode, dTime, iCapacity),
+								   piCandidates, pdProbability, &Step);
+			}
+		}
+
+		if (m_bStopRunning)
+			return false;
+
+		// no feasible node left, close the current tour
+		if (Step.iCount == 0)
+		{
+			if (iCustomer > 0)
+			{
+				dToursDistance += ppdDistanceMatrix[iLastNode][m_iCustomerCount];
+				ppiTourMatrix[iToursVehicleCount][0] = iCustomer;
+				iToursVehicleCount++;
 			}
 
 			break;
 		}
-		while (false);
 
-		// add node
-		pbNodesVisited[iNextNode] = true;
+		if (bExploit)
+			iNextNode = Step.iBestNode;
+		else
+		{
+			// exploration, binary search for the first prefix sum >= dTemp
+			dTemp = pRandom->rand() * Step.dSum;
+
+			if (Step.dSum > 0.0 && Step.dSum <= DBL_MAX)
+			{
+				j = 0;
+				iHigh = Step.iCount-1;
+
+				while (j < iHigh)
+				{
+					iMid = (j+iHigh) >> 1;
 
-		// local pheromone update
-		ppdPheromoneMatrix[iLastNode][iNextNode] *= 1.0-m_dXi;
-		ppdPheromoneMatrix[iLastNode][iNextNode] += m_dXi*dTau0;
+					if (pdProbability[iMid] < dTemp)
+						j = iMid+1;
+					else
+						iHigh = iMid;
+				}
+			}
+			else // values vanished or overflowed, pick uniformly
+				j = pRandom->randInt(Step.iCount-1);
 
-		if (iNextNode < m_iCustomerCount) // customer
+			iNextNode = piCandidates[j];
+		}
+
+		// local pheromone update, deferred if the ants run at the same time
+		if (pAnt->piArcs != NULL)
 		{
-			if (iLastNode > m_iCustomerCount)
-				dDistance = ppdDistanceMatrix[m_iCustomerCount][iNextNode];
-			else
-				dDistance = ppdDistanceMatrix[iLastNode][iNextNode];
+			pAnt->piArcs[2*pAnt->iArcCount] = iLastNode;
+			pAnt->piArcs[2*pAnt->iArcCount+1] = iNextNode;
+			pAnt->iArcCount++;
+		}
+		else
+			pPheromone->update(iLastNode, iNextNode, 1.0-m_dXi, m_dXi*dTau0);
+
+		if (iNextNode != m_iCustomerCount) // customer
+		{
+			BITSET_SET(puNodesVisited, iNextNode);
+			iCustomersLeft--;
+
+			dDistance = ppdDistanceMatrix[iLastNode][iNextNode];
 
 			dToursDistance += dDistance;
 			dTime += dDistance;
@@ -1134,32 +2045,21 @@ bool VrptwMACS::new_active_ant(bool bVEI,
 
 			ppiTourMatrix[iToursVehicleCount][++iCustomer] = iNextNode;
 		}
-		else // duplicated depot
+		else // depot, only reached from a customer
 		{
-			if (iLastNode >= m_iCustomerCount)
-				dDistance = 0.0;
-			else
-				dDistance = ppdDistanceMatrix[iLastNode][m_iCustomerCount];
-
-			dToursDistance += dDistance;
+			dToursDistance += ppdDistanceMatrix[iLastNode][m_iCustomerCount];
 
 			ppiTourMatrix[iToursVehicleCount][0] = iCustomer;
 			iToursVehicleCount++;
 
-			// any customer not visited yet?
-			for (i=0; i<m_iCustomerCount; i++)
-			{
-				if (pbNodesVisited[i] == false)
-					break;
-			}
-
-			if (i == m_iCustomerCount)
+			if (iCustomersLeft == 0)
 				break; // all customers visited
 
 			if (iToursVehicleCount < iMaxVehicleCount)
 			{
 				// next tour
-				ppiTourMatrix[iToursVehicleCount][m_iToursMaxSize] = iNextNode;
+				ppiTourMatrix[iToursVehicleCount][m_iToursMaxSize]
+					= m_iCustomerCount + iToursVehicleCount;
 				iCustomer = 0;
 				dTime = 0.0;
 				iCapacity = iMaxCapacity;	
@@ -1172,50 +2072,49 @@ bool VrptwMACS::new_active_ant(bool bVEI,
 	}
 	while (true);
 
-	*piToursVehicleCount = iToursVehicleCount;
-	*pdToursDistance = dToursDistance;
+	pAnt->iToursVehicleCount = iToursVehicleCount;
 
 	// tentatively insert non visited customers
-	if (insertion_procedure(bVEI, pbNodesVisited, iToursVehicleCount,
-							ppiTourMatrix, pdToursDistance) == false)
+	if (insertion_procedure(pAnt, iToursVehicleCount, &dToursDistance) == false)
 	{
+		pAnt->dToursDistance = dToursDistance;
 		return false; // not feasable
 	}
 	
-	if (bVEI)
-		return true;
-
-	// local search
-	if (ls_intra_exchange_matrix(iToursVehicleCount, pdToursDistance,
-								 ppiTourMatrix, &m_bStopRunning) != 0)
-	{
-		return false;
-	}
-							 
-	if (ls_cross_exchange_matrix(iToursVehicleCount, pdToursDistance,
-								 ppiTourMatrix, &m_bStopRunning) != 0)
+	if (bVEI == false)
 	{
-		return false;	
+		// local search
+		resetLocalSearchState(iToursVehicleCount, &pAnt->LSState);
+
+		if (ls_vnd_matrix(iToursVehicleCount, &dToursDistance, ppiTourMatrix,
+						  &m_bStopRunning, &pAnt->LSState) != 0)
+		{
+			return false;
+		}
 	}
 
+	pAnt->dToursDistance = dToursDistance;
+	pAnt->bFeasible = true;
+
 	return true;
 }
 
-bool VrptwMACS::insertion_procedure(bool bVEI,
-									bool *pbNodesVisited,
+bool VrptwMACS::insertion_procedure(ANT_t *pAnt,
 									int iVehicleCount,
-									int **ppiTourMatrix,
 									double *pdTourDistance)
 {
 	bool bRestart;
-	int i, j, iCustomer, iRoute, iCustomersToInsert;
+	int i, j, iCustomer, iRoute, iDepot, iCustomersToInsert;
 	int iCapacity, iMaxCapacity, iDepotDueDate;
-	int iLastCustomer, iNextCustomer;
+	int iLastNode, iNextNode, iLastCustomer, iNextCustomer;
 	double dTime, dEarliestStart, dLatestArrival, dTourDistance;
 	int *piCustomerReadyTime, *piCustomerDueDate, *piCustomerServiceTime;
+	unsigned int *puNodesVisited;
 	int *piCustomersToVisit;
 	double *pdLatestArrivals;
 	double **ppdDistanceMatrix;
+	int **ppiTourMatrix;
+	RouteIndex *pIndex;
 
 	// init vars
 	dTourDistance = *pdTourDistance;
@@ -1228,22 +2127,22 @@ bool VrptwMACS::insertion_procedure(bool bVEI,
 	iDepotDueDate = m_pInstanceData->getDepotDueDate();
 	iCapacity = iMaxCapacity = m_pInstanceData->getCapacity();
 
-	if (bVEI)
-	{
-		piCustomersToVisit = m_piCustomersToVisit_vei;
-		pdLatestArrivals = m_pdLatestArrivals_vei;
-	}
-	else
-	{
-		piCustomersToVisit = m_piCustomersToVisit_time;
-		pdLatestArrivals = m_pdLatestArrivals_time;
-	}
+	puNodesVisited = pAnt->puNodesVisited;
+	piCustomersToVisit = pAnt->piCustomersToVisit;
+	pdLatestArrivals = pAnt->pdLatestArrivals;
+	ppiTourMatrix = pAnt->ppiTourMatrix;
+	pIndex = &pAnt->Index;
+
+	// the customers are inserted into the index, a route is written back
+	// to the tour matrix when it is left
+	if (pIndex->build(iVehicleCount, ppiTourMatrix) != 0)
+		return false;
 
 	j = 0;
 
 	for (i=0; i<m_iCustomerCount; i++)
 	{
-		if (pbNodesVisited[i] == false)
+		if (BITSET_TEST(puNodesVisited, i) == 0)
 			piCustomersToVisit[++j] = i;
 	}
 
@@ -1258,46 +2157,53 @@ bool VrptwMACS::insertion_procedure(bool bVEI,
 	for (iRoute=0; iRoute<iVehicleCount; iRoute++)
 	{
 		bRestart = false;
+		iDepot = pIndex->getDepot(iRoute);
 
 		// check capacity
 		iCapacity = iMaxCapacity;
 
-		for (i=1; i<=ppiTourMatrix[iRoute][0]; i++)
-			iCapacity -= m_piCustomerDemand[ppiTourMatrix[iRoute][i]];
+		for (iNextNode = pIndex->getSucc(iDepot); iNextNode != iDepot;
+			 iNextNode = pIndex->getSucc(iNextNode))
+		{
+			iCapacity -= m_piCustomerDemand[iNextNode];
+		}
 
 		// comp latest arrival times
 		dLatestArrival = iDepotDueDate;
 		iLastCustomer = m_iCustomerCount; // depot
 
-		for (i=ppiTourMatrix[iRoute][0]; i>0; i--)
+		for (iNextNode = pIndex->getPred(iDepot); iNextNode != iDepot;
+			 iNextNode = pIndex->getPred(iNextNode))
 		{
-			iNextCustomer = ppiTourMatrix[iRoute][i];
-			dLatestArrival -= ppdDistanceMatrix[iLastCustomer][iNextCustomer];
+			dLatestArrival -= ppdDistanceMatrix[iLastCustomer][iNextNode];
 
 			dLatestArrival =
-				__min(dLatestArrival-piCustomerServiceTime[iNextCustomer],
-					  piCustomerDueDate[iNextCustomer]);
+				__min(dLatestArrival-piCustomerServiceTime[iNextNode],
+					  piCustomerDueDate[iNextNode]);
 								   
-			pdLatestArrivals[i] = dLatestArrival;
-			iLastCustomer = iNextCustomer;
+			pdLatestArrivals[iNextNode] = dLatestArrival;
+			iLastCustomer = iNextNode;
 		}
 
 		// check all gaps, starting with the first one (depot -> customer1)
 		dEarliestStart = 0.0;
 
+		iLastNode = iDepot;
 		iLastCustomer = m_iCustomerCount;	// depot
 
-		for (i=1; i<=ppiTourMatrix[iRoute][0]+1; i++)
+		do
 		{
-			if (i == ppiTourMatrix[iRoute][0]+1) // depot
+			iNextNode = pIndex->getSucc(iLastNode);
+
+			if (iNextNode == iDepot)
 			{
 				iNextCustomer = m_iCustomerCount;
 				dLatestArrival = iDepotDueDate;
 			}
 			else
 			{
-				iNextCustomer = ppiTourMatrix[iRoute][i];
-				dLatestArrival = pdLatestArrivals[i];
+				iNextCustomer = iNextNode;
+				dLatestArrival = pdLatestArrivals[iNextNode];
 			}
 
 			// try to insert one of the remaining customers
@@ -1327,17 +2233,19 @@ bool VrptwMACS::insertion_procedure(bool bVEI,
 					continue;
 
 				// customer fits into tour, insert it
-				insertCustomerIntoTourMatrix(i, iCustomer, ppiTourMatrix[iRoute]);
+				pIndex->insertAfter(iLastNode, iCustomer);
 
-				pbNodesVisited[iCustomer] = true;
+				BITSET_SET(puNodesVisited, iCustomer);
 				dTourDistance += ppdDistanceMatrix[iLastCustomer][iCustomer];
 				dTourDistance += ppdDistanceMatrix[iCustomer][iNextCustomer];
+				dTourDistance -= ppdDistanceMatrix[iLastCustomer][iNextCustomer];
 
 				// remove inserted customer from list
 				removeCustomerFromList(j, piCustomersToVisit);
 
 				if (--iCustomersToInsert == 0)
 				{
+					pIndex->writeRoute(iRoute, ppiTourMatrix[iRoute]);
 					*pdTourDistance = dTourDistance;
 					return true; // all customers inserted
 				}
@@ -1359,26 +2267,18 @@ bool VrptwMACS::insertion_procedure(bool bVEI,
 
 			dEarliestStart += piCustomerServiceTime[iNextCustomer];
 
+			iLastNode = iNextNode;
 			iLastCustomer = iNextCustomer;
 		}
+		while (iLastNode != iDepot);
+
+		if (bRestart == false)
+			pIndex->writeRoute(iRoute, ppiTourMatrix[iRoute]);
 	}
 
 	return false; // not feasible
 }
 
-void VrptwMACS::insertCustomerIntoTourMatrix(int iPos,
-											 int iCustomer,
-											 int *piTourMatrix)
-{
-	int i;
-
-	for (i=piTourMatrix[0]; i>=iPos; i--)
-		piTourMatrix[i+1] = piTourMatrix[i];
-
-	piTourMatrix[i+1] = iCustomer;
-	piTourMatrix[0]++;
-}
-
 void VrptwMACS::removeCustomerFromList(int iPos,
 									   int *piList)
 {
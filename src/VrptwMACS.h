@@ -38,6 +38,12 @@
 
 #include "Vrptw.h"
 #include "SolutionLogger.h"
+#include "ScratchArena.h"
+#include "RouteIndex.h"
+#include "PheromoneTable.h"
+#include "WorkerPool.h"
+#include "SolutionMailbox.h"
+#include "AntRandom.h"
 #include "utils.h"
 #include "pthread.h"
 
@@ -69,6 +75,47 @@ public:
 	void setParamXi(double dXi)
 		{ if (dXi >= 0.0 && dXi <= 1.0) m_dXi = dXi; };
 
+	// nearest customers scored per step of an ant beside the depot, all
+	// nodes only if none of them fits, 0 = all nodes
+	void setParamCandidateListSize(int iSize)
+		{ if (iSize >= 0) m_iCandidateListSize = iSize; };
+
+	// pheromone is stored sparse from this many nodes on, 0 = always dense
+	// (default)
+	void setParamSparsePheromoneNodes(int iNodes)
+		{ if (iNodes >= 0) m_iSparsePheromoneNodes = iNodes; };
+
+	// weight of tau0 when the pheromone is carried over to the colonies of
+	// the next vehicle count, 0.1 by default, 1 = start from tau0 again
+	void setParamPheromoneSmoothing(double dWeight)
+		{ if (dWeight >= 0.0 && dWeight <= 1.0) m_dPheromoneSmoothing = dWeight; };
+
+	// threads which construct the ants of a colony at the same time,
+	// 0 = one ant after the other in the colony thread
+	void setParamAntThreads(int iThreads)
+		{ if (iThreads >= 0) m_iAntThreads = iThreads; };
+
+	// independent pairs of colonies, 1 = one acs_vei and one acs_time
+	void setParamIslandCount(int iCount)
+		{ if (iCount >= 1) m_iIslandCount = iCount; };
+
+	// iterations of acs_time between two exchanges of the best solutions
+	// of the islands, 0 = never
+	void setParamMigrationInterval(int iIterations)
+		{ if (iIterations >= 0) m_iMigrationInterval = iIterations; };
+
+	// 0 = seeds from the clock. with a seed the ants get their own random
+	// numbers derived from it and the colonies run in lockstep, they
+	// exchange their solutions after every iteration. the same seed and
+	// params give the same result as long as the run isn't ended by the
+	// calc time
+	void setParamSeed(unsigned int uSeed) { m_uSeed = uSeed; };
+
+	// iterations of the colonies in lockstep until the run ends, summed
+	// over the vehicle counts, 0 = calc time only. only used with a seed
+	void setParamMaxIterations(int iIterations)
+		{ if (iIterations >= 0) m_iMaxIterations = iIterations; };
+
 	int getParamAntsCount() { return m_iAntsCount; };
 	
 	short getParamBeta() { return m_nBeta; };
@@ -77,20 +124,217 @@ public:
 	
 	double getParamRoh() { m_dRho; };
 
+	int getParamCandidateListSize() { return m_iCandidateListSize; };
+
+	int getParamSparsePheromoneNodes() { return m_iSparsePheromoneNodes; };
+
+	double getParamPheromoneSmoothing() { return m_dPheromoneSmoothing; };
+
+	int getParamAntThreads() { return m_iAntThreads; };
+
+	int getParamIslandCount() { return m_iIslandCount; };
+
+	int getParamMigrationInterval() { return m_iMigrationInterval; };
+
+	unsigned int getParamSeed() { return m_uSeed; };
+
+	int getParamMaxIterations() { return m_iMaxIterations; };
+
 protected:
+	// feasible nodes of one ant step, the node list keeps prefix sums
+	typedef struct
+	{
+		int iCount;
+		int iBestNode;
+		double dBestValue;
+		double dSum;
+	} ANT_STEP_t;
+
+	// an ant with its own random numbers and buffers, the ants of a colony
+	// may be constructed at the same time
+	typedef struct
+	{
+		bool bVEI;
+		PheromoneTable *pPheromone;
+		int *piIN;				// acs_vei only
+		AntRandom Random;
+		ScratchArena Arena;
+		RouteIndex Index;
+		LS_STATE_t LSState;		// acs_time only
+		unsigned int *puNodesVisited;
+		double *pdProbability;
+		int *piCandidates;
+		float *pfPheromoneRow;
+		int **ppiTourMatrix;
+		int *piCustomersToVisit;
+		double *pdLatestArrivals;
+		int *piArcs;			// arcs of the local updates, NULL = update at once
+		int iArcCount;
+
+		// constructed solution
+		bool bFeasible;
+		int iToursVehicleCount;
+		double dToursDistance;
+	} ANT_t;
+
+	typedef struct
+	{
+		VrptwMACS *pMACS;
+		ANT_t *pAnts;
+		double dTau0;
+		int iMaxVehicleCount;
+	} ANT_JOB_t;
+
+	// immutable solution shared by the colonies with the arcs of its
+	// routes. iRefCount counts the places publishing the snapshot, not its
+	// readers: a snapshot without references is retired and only freed
+	// after every colony passed the top of its loop, so a reader never
+	// has to block
+	typedef struct SNAPSHOT_s
+	{
+		int iRefCount;
+		int iVehicleCount;
+		double dDistance;
+		int **ppiTourMatrix;
+		int *piArcs;		// from and to of every arc, the depot is node n
+		int iArcCount;
+		unsigned int uRetireEpoch;
+		struct SNAPSHOT_s *pNextRetired;
+	}
+	SNAPSHOT_t;
+
+	// threads of an island, kept for the next run like the colony threads
+	typedef struct
+	{
+		WorkerPool AntPool_vei;
+		WorkerPool AntPool_time;
+		WorkerPool LocalSearchPool_time;	// parallel operators of its ant
+	} ISLAND_POOLS_t;
+
+	// a pair of colonies with its own pheromone, ants and best solution,
+	// the islands pass their best solutions on in a ring
+	typedef struct
+	{
+		VrptwMACS *pMACS;
+		int iIsland;
+		ScratchArena Arena;
+		SolutionMailbox Mailbox;	// best solutions of the previous island
+		ISLAND_POOLS_t *pPools;
+
+		// best solution of the island, published by acs_time
+		SNAPSHOT_t *pBest;
+
+		// snapshot epoch seen at the top of the loop, UINT_MAX = idle
+		unsigned int uEpoch_vei;
+		unsigned int uEpoch_time;
+
+		// solutions of the last iteration in lockstep, published by
+		// exchangeSolutions()
+		SNAPSHOT_t *pFound_vei;
+		SNAPSHOT_t *pFound_time;
+
+		// acs_vei
+		PheromoneTable Pheromone_vei;
+		int *piIN_vei;
+		int **ppiTourMatrix_acsvei;
+		ANT_t *pAnts_vei;
+
+		// acs_time
+		PheromoneTable Pheromone_time;
+		int **ppiTourMatrix_newbest_time;
+		int **ppiTourMatrix_migrant_time;
+		ANT_t *pAnts_time;
+	} ISLAND_t;
+
 	void sortCustomersByDemand(int *piArray);
 	
 	void removeCustomerFromList(int iPos,
 								int *piList);
 	
-	void insertCustomerIntoTourMatrix(int iPos,
-									  int iCustomer,
-									  int *piTourMatrix);
-	
 	void init();
 	
 	void cleanup();
 
+	int createCandidateLists();
+
+	int createIsland(ISLAND_t *pIsland,
+					 int iIsland,
+					 int iVehicleCount,
+					 bool bSparse);
+
+	void freeIsland(ISLAND_t *pIsland);
+
+	static int resizePool(WorkerPool *pPool,
+						  int iThreadCount);
+
+	int createAnts(ISLAND_t *pIsland,
+				   bool bVEI,
+				   int iVehicleCount,
+				   ANT_t **ppAnts);
+
+	void freeAnts(ANT_t **ppAnts);
+
+	void migrate(ISLAND_t *pIsland,
+				 int iVehicleCount);
+
+	SNAPSHOT_t *createSnapshot(int iVehicleCount,
+							   double dDistance,
+							   int **ppiTourMatrix);
+
+	void publishSnapshot(SNAPSHOT_t **ppSlot,
+						 SNAPSHOT_t *pSnapshot);
+
+	bool publishBestSoFar(SNAPSHOT_t *pSnapshot);
+
+	void releaseSnapshot(SNAPSHOT_t *pSnapshot);
+
+	void pushRetiredSnapshot(SNAPSHOT_t *pSnapshot);
+
+	void freeRetiredSnapshots();
+
+	void reclaimSnapshots();
+
+	void quiesce(unsigned int *puEpoch)
+		{ UIntAtomicStore(puEpoch, UIntAtomicLoad(&m_uSnapshotEpoch)); };
+
+	static SNAPSHOT_t *readSnapshot(SNAPSHOT_t **ppSlot)
+		{ return (SNAPSHOT_t*)PtrAtomicLoad((void**)ppSlot); };
+
+	void logSolution(SNAPSHOT_t *pSnapshot);
+
+	bool synchronize();
+
+	void exchangeSolutions();
+
+	static unsigned int deriveSeed(unsigned int uSeed,
+								   int iIsland,
+								   bool bVEI,
+								   int iAnt);
+
+	double calcTransitionValue(ANT_t *pAnt,
+							   int iNode,
+							   int iLastNode,
+							   double dTime,
+							   int iCapacity);
+
+	void scoreCustomers(ANT_t *pAnt,
+						bool bExploit,
+						int iLastNode,
+						double dTime,
+						int iCapacity,
+						ANT_STEP_t *pStep);
+
+	static void addTransitionValue(bool bExploit,
+								   int iNode,
+								   double dValue,
+								   int *piCandidates,
+								   double *pdProbability,
+								   ANT_STEP_t *pStep);
+
+	static void colony_job(void *pArg,
+						   int iJob,
+						   int iThread);
+
 	static void *acs_vei(void *pArg);
 	
 	static void *acs_time(void *pArg);
@@ -100,17 +344,21 @@ protected:
 							   int **ppiDest,
 							   int **ppiSrc);
 	
-	bool new_active_ant(bool bVEI,
-						int iNodes,
+	void construct_ants(ISLAND_t *pIsland,
+						bool bVEI,
 						double dTau0,
-						int iVehicleCount,
-						int *piToursVehicleCount,
-						double *pdToursDistance);
+						int iMaxVehicleCount);
+
+	static void construct_ant_job(void *pArg,
+								  int iJob,
+								  int iThread);
+
+	bool new_active_ant(ANT_t *pAnt,
+						double dTau0,
+						int iMaxVehicleCount);
 						
-	bool insertion_procedure(bool bVEI,
-							 bool *pbNodesVisited,
+	bool insertion_procedure(ANT_t *pAnt,
 							 int iVehicleCount,
-							 int **ppiTourMatrix,
 							 double *pdTourDistance);
 
 	// global
@@ -126,8 +374,20 @@ protected:
 	double m_dQ0;
 	double m_dRho;
 	double m_dXi;
+	int m_iCandidateListSize;
+	int m_iSparsePheromoneNodes;
+	double m_dPheromoneSmoothing;
+	int m_iAntThreads;
+	int m_iIslandCount;
+	int m_iMigrationInterval;
+	unsigned int m_uSeed;
+	int m_iMaxIterations;
 	int m_iToursMaxSize;
 
+	// nearest customers of every customer and of the depot (last row)
+	int **m_ppiCandidateList;
+	int m_iCandidateListLength;
+
 	int m_iDepotDueDate;
 	int m_iCustomerCount;
 	int *m_piCustomerDemand;
@@ -135,32 +395,37 @@ protected:
 	int *m_piCustomerDueDate;
 	int *m_piCustomerServiceTime;
 
-	bool m_bRWLockBestSoFar;
-	pthread_rwlock_t m_rwlockBestSoFar;
-	int **m_ppiTourMatrix_bestsofar;
-	int m_iVehicleCount_bestsofar;
-	double m_dDistance_bestsofar;
-	int **m_ppiTourMatrix_acsvei;
-
-	// acs_vei
-	MTRand m_MTRand_vei;
-	double **m_ppdPheromoneMatrix_vei;
-	int *m_piIN_vei;
-	bool *m_pbNodesVisited_vei;
-	double *m_pdProbability_vei;
-	int **m_ppiTourMatrix_vei;
-	int *m_piCustomersToVisit_vei;
-	double *m_pdLatestArrivals_vei;
-
-	// acs_time
-	MTRand m_MTRand_time;
-	double **m_ppdPheromoneMatrix_time;
-	bool *m_pbNodesVisited_time;
-	double *m_pdProbability_time;
-	int **m_ppiTourMatrix_time;
-	int **m_ppiTourMatrix_newbest_time;
-	int *m_piCustomersToVisit_time;
-	double *m_pdLatestArrivals_time;
+	bool m_bMutexSolutionLogger;
+	pthread_mutex_t m_mutexSolutionLogger;
+	SNAPSHOT_t *m_pBestSoFar;
+	SNAPSHOT_t *m_pRetiredSnapshots;
+	unsigned int m_uSnapshotEpoch;
+
+	ISLAND_t *m_pIslands;
+	int m_iIslands;
+	ISLAND_POOLS_t *m_pIslandPools;
+	int m_iIslandPools;
+
+	// colonies of all islands, acs_vei only runs if the colonies were
+	// restarted with more than one vehicle
+	WorkerPool m_ColonyPool;
+	int m_iRestartVehicleCount;
+
+	// lockstep of the colonies with a seed
+	bool m_bSynchronized;
+	int m_iLimitReached;	// set by main and exchangeSolutions()
+	int m_iIterations;		// of the run
+	int m_iRounds;			// since the restart
+
+	// colonies meeting in synchronize(), the count of a meeting changes
+	// when all colonies arrived
+	int m_iColonies;
+	int m_iColoniesArrived;
+	unsigned int m_uMeeting;
+	bool m_bMutexColonies;
+	pthread_mutex_t m_mutexColonies;
+	bool m_bCondColonies;
+	pthread_cond_t m_condColonies;
 };
 
 #endif // _VRPTW_MACS_H_
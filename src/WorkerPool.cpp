@@ -0,0 +1,272 @@
+//
+// WorkerPool.cpp
+//
+// Copyright (c) 2006-2007 Pascal Drecker
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+///// includes /////
+
+#include "WorkerPool.h"
+#include <stdlib.h>
+
+
+///// classes /////
+
+WorkerPool::WorkerPool()
+{
+	m_bMutex = false;
+	m_bCondWork = false;
+	m_bCondDone = false;
+
+	m_iThreadCount = 0;
+	m_pThreads = NULL;
+	m_pWorkers = NULL;
+
+	m_bStop = false;
+	m_pfnJob = NULL;
+	m_pJobArg = NULL;
+	m_iJobCount = 0;
+	m_iNextJob = 0;
+	m_iJobsDone = 0;
+}
+
+WorkerPool::~WorkerPool()
+{
+	stop();
+}
+
+int WorkerPool::start(int iThreadCount)
+{
+	int i;
+
+	// check params
+	if (iThreadCount < 1)
+		return -1;
+
+	stop();
+
+	// init mutex and condition variables
+	if (pthread_mutex_init(&m_mutex, NULL) != 0)
+		return -2;
+
+	m_bMutex = true;
+
+	if (pthread_cond_init(&m_condWork, NULL) != 0)
+	{
+		stop();
+		return -3;
+	}
+
+	m_bCondWork = true;
+
+	if (pthread_cond_init(&m_condDone, NULL) != 0)
+	{
+		stop();
+		return -3;
+	}
+
+	m_bCondDone = true;
+
+	// allocate memory
+	m_pThreads = (pthread_t*)malloc(sizeof(pthread_t)*iThreadCount);
+	m_pWorkers = (WORKER_t*)malloc(sizeof(WORKER_t)*iThreadCount);
+
+	if (m_pThreads == NULL || m_pWorkers == NULL)
+	{
+		stop();
+		return -4;
+	}
+
+	m_bStop = false;
+	m_iJobCount = 0;
+	m_iNextJob = 0;
+	m_iJobsDone = 0;
+
+	// create threads
+	for (i=0; i<iThreadCount; i++)
+	{
+		m_pWorkers[i].pPool = this;
+		m_pWorkers[i].iThread = i;
+
+		if (pthread_create(&m_pThreads[i], NULL, worker,
+						   (void*)&m_pWorkers[i]) != 0)
+		{
+			stop();
+			return -5;
+		}
+
+		m_iThreadCount++;
+	}
+
+	return 0;
+}
+
+void WorkerPool::stop()
+{
+	int i;
+	void *pThreadReturn;
+
+	if (m_iThreadCount != 0)
+	{
+		pthread_mutex_lock(&m_mutex);
+		m_bStop = true;
+		pthread_cond_broadcast(&m_condWork);
+		pthread_mutex_unlock(&m_mutex);
+
+		for (i=0; i<m_iThreadCount; i++)
+			pthread_join(m_pThreads[i], &pThreadReturn);
+
+		m_iThreadCount = 0;
+	}
+
+	if (m_pThreads != NULL)
+	{
+		free(m_pThreads);
+		m_pThreads = NULL;
+	}
+
+	if (m_pWorkers != NULL)
+	{
+		free(m_pWorkers);
+		m_pWorkers = NULL;
+	}
+
+	if (m_bCondDone)
+	{
+		pthread_cond_destroy(&m_condDone);
+		m_bCondDone = false;
+	}
+
+	if (m_bCondWork)
+	{
+		pthread_cond_destroy(&m_condWork);
+		m_bCondWork = false;
+	}
+
+	if (m_bMutex)
+	{
+		pthread_mutex_destroy(&m_mutex);
+		m_bMutex = false;
+	}
+}
+
+// hand out the jobs 0..iJobCount-1 and wait until all of them are done
+int WorkerPool::run(int iJobCount, JOB_FUNC pfnJob, void *pArg)
+{
+	int iRet;
+
+	iRet = post(iJobCount, pfnJob, pArg);
+
+	if (iRet != 0)
+		return iRet;
+
+	wait();
+
+	return 0;
+}
+
+// hand out the jobs 0..iJobCount-1 without waiting for them
+int WorkerPool::post(int iJobCount, JOB_FUNC pfnJob, void *pArg)
+{
+	// check params
+	if (m_iThreadCount == 0 || pfnJob == NULL)
+		return -1;
+
+	if (iJobCount < 1)
+		return 0;
+
+	pthread_mutex_lock(&m_mutex);
+
+	m_pfnJob = pfnJob;
+	m_pJobArg = pArg;
+	m_iNextJob = 0;
+	m_iJobsDone = 0;
+	m_iJobCount = iJobCount;
+
+	pthread_cond_broadcast(&m_condWork);
+
+	pthread_mutex_unlock(&m_mutex);
+
+	return 0;
+}
+
+// wait until all jobs of the last post() are done
+void WorkerPool::wait()
+{
+	if (m_iThreadCount == 0)
+		return;
+
+	pthread_mutex_lock(&m_mutex);
+
+	while (m_iJobsDone < m_iJobCount)
+		pthread_cond_wait(&m_condDone, &m_mutex);
+
+	m_iJobCount = 0;
+	m_iNextJob = 0;
+
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void *WorkerPool::worker(void *pArg)
+{
+	int iJob, iThread;
+	JOB_FUNC pfnJob;
+	void *pJobArg;
+	WorkerPool *pPool;
+
+	pPool = ((WORKER_t*)pArg)->pPool;
+	iThread = ((WORKER_t*)pArg)->iThread;
+
+	pthread_mutex_lock(&pPool->m_mutex);
+
+	do
+	{
+		// wait for a job
+		while (pPool->m_bStop == false
+			   && pPool->m_iNextJob >= pPool->m_iJobCount)
+		{
+			pthread_cond_wait(&pPool->m_condWork, &pPool->m_mutex);
+		}
+
+		if (pPool->m_bStop)
+			break;
+
+		iJob = pPool->m_iNextJob++;
+		pfnJob = pPool->m_pfnJob;
+		pJobArg = pPool->m_pJobArg;
+
+		pthread_mutex_unlock(&pPool->m_mutex);
+
+		pfnJob(pJobArg, iJob, iThread);
+
+		pthread_mutex_lock(&pPool->m_mutex);
+
+		// last job of the batch done?
+		if (++pPool->m_iJobsDone == pPool->m_iJobCount)
+			pthread_cond_signal(&pPool->m_condDone);
+	}
+	while (true);
+
+	pthread_mutex_unlock(&pPool->m_mutex);
+
+	return NULL;
+}
@@ -0,0 +1,95 @@
+//
+// WorkerPool.h
+//
+// Copyright (c) 2006-2007 Pascal Drecker
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _WORKERPOOL_H_
+#define _WORKERPOOL_H_
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+
+///// includes /////
+
+#include "pthread.h"
+
+
+///// classes /////
+
+// a fixed set of threads which process batches of independent jobs;
+// run() waits for its batch, post() returns at once and wait() waits for
+// the batch later. only one thread may hand out jobs at a time and only
+// one batch may be pending
+class WorkerPool
+{
+public:
+	typedef void (*JOB_FUNC)(void *pArg, int iJob, int iThread);
+
+	WorkerPool();
+
+	virtual ~WorkerPool();
+
+	int start(int iThreadCount);
+
+	void stop();
+
+	int run(int iJobCount, JOB_FUNC pfnJob, void *pArg);
+
+	int post(int iJobCount, JOB_FUNC pfnJob, void *pArg);
+
+	void wait();
+
+	int getThreadCount() { return m_iThreadCount; };
+
+protected:
+	typedef struct
+	{
+		WorkerPool *pPool;
+		int iThread;
+	}
+	WORKER_t;
+
+	static void *worker(void *pArg);
+
+	bool m_bMutex;
+	pthread_mutex_t m_mutex;
+	bool m_bCondWork;
+	pthread_cond_t m_condWork;
+	bool m_bCondDone;
+	pthread_cond_t m_condDone;
+
+	int m_iThreadCount;
+	pthread_t *m_pThreads;
+	WORKER_t *m_pWorkers;
+
+	// current batch
+	bool m_bStop;
+	JOB_FUNC m_pfnJob;
+	void *m_pJobArg;
+	int m_iJobCount;
+	int m_iNextJob;
+	int m_iJobsDone;
+};
+
+#endif // _WORKERPOOL_H_
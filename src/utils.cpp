@@ -30,6 +30,11 @@
 ///// includes /////
 
 #include <stdlib.h>
+#include <time.h>
+
+#if defined(WIN32) || defined(WIN64)
+	#include <windows.h>
+#endif
 
 
 ///// functions /////
@@ -68,6 +73,23 @@ double **generate_double_matrix(int iM, int iN)
 	return ppdMatrix;
 }
 
+// m x n (rows x cols)
+float **generate_float_matrix(int iM, int iN)
+{
+	int i;
+	float **ppfMatrix;
+
+	ppfMatrix = (float**)malloc(sizeof(float) * iN * iM + sizeof(float *) * iM);
+
+	if (ppfMatrix == NULL)
+		return NULL;
+
+	for (i=0; i<iM; i++)
+		ppfMatrix[i] = (float*)(ppfMatrix + iM) + i * iN;
+
+	return ppfMatrix;
+}
+
 void IntCopy(int *piDest, const int *piSrc, size_t iCount)
 {
 	while (iCount--)
@@ -130,3 +152,30 @@ int DoubleCompare(const double *pdSrc1, const double *pdSrc2, size_t iCount)
 	return 0;
 }
 
+// cpu time of the calling thread
+long long ThreadCpuMicroseconds()
+{
+#if defined(WIN32) || defined(WIN64)
+	FILETIME ftCreation, ftExit, ftKernel, ftUser;
+	ULARGE_INTEGER uliKernel, uliUser;
+
+	if (GetThreadTimes(GetCurrentThread(), &ftCreation, &ftExit, &ftKernel,
+					   &ftUser))
+	{
+		uliKernel.LowPart = ftKernel.dwLowDateTime;
+		uliKernel.HighPart = ftKernel.dwHighDateTime;
+		uliUser.LowPart = ftUser.dwLowDateTime;
+		uliUser.HighPart = ftUser.dwHighDateTime;
+
+		// 100 ns units
+		return (long long)((uliKernel.QuadPart + uliUser.QuadPart) / 10);
+	}
+#else
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+		return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+
+	return (long long)clock() * 1000000 / CLOCKS_PER_SEC;
+}
@@ -42,16 +42,26 @@
 	#define __max(a,b)		((a)<(b))?(b):(a)
 #endif
 
+// bit sets in 32 bit words
+#define BITSET_WORDS(n)		(((n)+31) >> 5)
+#define BITSET_TEST(p,i)	(((p)[(i) >> 5] >> ((i) & 31)) & 1)
+#define BITSET_SET(p,i)		((p)[(i) >> 5] |= 1u << ((i) & 31))
+
 
 ///// includes //////
 
 #include "MersenneTwister.h"
 
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
 
 ///// prototypes /////
 
 int **generate_int_matrix(int iM, int iN);
 double **generate_double_matrix(int iM, int iN);
+float **generate_float_matrix(int iM, int iN);
 
 void IntCopy(int *piDest, const int *piSrc, size_t iCount);
 void IntSet(int *piDest, int iValue, size_t iCount);
@@ -61,5 +71,94 @@ void DoubleCopy(double *pdDest, const double *pdSrc, size_t iCount);
 void DoubleSet(double *pdDest, double dValue, size_t iCount);
 int DoubleCompare(const double *pdSrc1, const double *pdSrc2, size_t iCount);
 
+long long ThreadCpuMicroseconds();
+
+
+///// atomics /////
+
+// sequentially consistent operations on words shared by threads
+
+#if defined(_MSC_VER)
+
+inline int IntAtomicLoad(volatile int *piValue)
+	{ return _InterlockedCompareExchange((volatile long*)piValue, 0, 0); }
+
+inline void IntAtomicStore(volatile int *piValue, int iValue)
+	{ _InterlockedExchange((volatile long*)piValue, iValue); }
+
+inline int IntAtomicExchange(volatile int *piValue, int iValue)
+	{ return _InterlockedExchange((volatile long*)piValue, iValue); }
+
+// returns the new value
+inline int IntAtomicAdd(volatile int *piValue, int iValue)
+	{ return _InterlockedExchangeAdd((volatile long*)piValue, iValue) + iValue; }
+
+inline unsigned int UIntAtomicLoad(volatile unsigned int *puValue)
+	{ return _InterlockedCompareExchange((volatile long*)puValue, 0, 0); }
+
+inline void UIntAtomicStore(volatile unsigned int *puValue,
+							unsigned int uValue)
+	{ _InterlockedExchange((volatile long*)puValue, (long)uValue); }
+
+// returns the new value
+inline unsigned int UIntAtomicAdd(volatile unsigned int *puValue,
+								  unsigned int uValue)
+	{ return _InterlockedExchangeAdd((volatile long*)puValue, (long)uValue)
+		+ uValue; }
+
+inline void *PtrAtomicLoad(void * volatile *ppValue)
+	{ return _InterlockedCompareExchangePointer(ppValue, NULL, NULL); }
+
+inline void *PtrAtomicExchange(void * volatile *ppValue, void *pValue)
+	{ return _InterlockedExchangePointer(ppValue, pValue); }
+
+// stores pValue if the slot holds pExpected, returns the old value
+inline void *PtrAtomicCompareExchange(void * volatile *ppValue,
+									  void *pExpected,
+									  void *pValue)
+	{ return _InterlockedCompareExchangePointer(ppValue, pValue, pExpected); }
+
+#else
+
+inline int IntAtomicLoad(volatile int *piValue)
+	{ return __atomic_load_n(piValue, __ATOMIC_SEQ_CST); }
+
+inline void IntAtomicStore(volatile int *piValue, int iValue)
+	{ __atomic_store_n(piValue, iValue, __ATOMIC_SEQ_CST); }
+
+inline int IntAtomicExchange(volatile int *piValue, int iValue)
+	{ return __atomic_exchange_n(piValue, iValue, __ATOMIC_SEQ_CST); }
+
+// returns the new value
+inline int IntAtomicAdd(volatile int *piValue, int iValue)
+	{ return __atomic_add_fetch(piValue, iValue, __ATOMIC_SEQ_CST); }
+
+inline unsigned int UIntAtomicLoad(volatile unsigned int *puValue)
+	{ return __atomic_load_n(puValue, __ATOMIC_SEQ_CST); }
+
+inline void UIntAtomicStore(volatile unsigned int *puValue,
+							unsigned int uValue)
+	{ __atomic_store_n(puValue, uValue, __ATOMIC_SEQ_CST); }
+
+// returns the new value
+inline unsigned int UIntAtomicAdd(volatile unsigned int *puValue,
+								  unsigned int uValue)
+	{ return __atomic_add_fetch(puValue, uValue, __ATOMIC_SEQ_CST); }
+
+inline void *PtrAtomicLoad(void * volatile *ppValue)
+	{ return __atomic_load_n(ppValue, __ATOMIC_SEQ_CST); }
+
+inline void *PtrAtomicExchange(void * volatile *ppValue, void *pValue)
+	{ return __atomic_exchange_n(ppValue, pValue, __ATOMIC_SEQ_CST); }
+
+// stores pValue if the slot holds pExpected, returns the old value
+inline void *PtrAtomicCompareExchange(void * volatile *ppValue,
+									  void *pExpected,
+									  void *pValue)
+	{ __atomic_compare_exchange_n(ppValue, &pExpected, pValue, false,
+		__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); return pExpected; }
+
+#endif
+
 
 #endif // _UTILS_H_